@@ -25,7 +25,6 @@
 #include "main.h"
 
 
-QAPInfo glob_qi;
 int from_random;
 
 
@@ -43,13 +42,13 @@ Init_Main(void)
  *  Displays parameters
  */
 void
-Display_Parameters(QAPInfo qi, int target_cost)
+Display_Parameters(QAPInfo qi, QAPCost target_cost)
 {
 }
 
 
 void  
-Swap(int *t, int r, int s)
+Swap(QAPInfo qi, int *t, int r, int s)
 {
   int temp;
   temp = t[r];
@@ -57,7 +56,7 @@ Swap(int *t, int r, int s)
   t[s] = temp;
 
   /* customize swap to also maintain in parallel the actual values */
-  QAP_Do_Swap(glob_qi, r, s);  
+  QAP_Do_Swap(qi, r, s);  
 }
 
 
@@ -65,7 +64,7 @@ Swap(int *t, int r, int s)
 
 /* General permutation function. t[] is must be initialized with 0, 1, ..., n-1 */
 int 
-Next_Permutation(int *t, int n) 
+Next_Permutation(QAPInfo qi, int *t, int n) 
 {
   int j, k, r, s;
 
@@ -78,10 +77,10 @@ Next_Permutation(int *t, int n)
   for(k = n-1; t[j] >= t[k]; k--)
     ;
 
-  Swap(t, j, k);
+  Swap(qi, t, j, k);
 
   for(r = n - 1, s = j + 1; r > s; r--, s++) 
-    Swap(t, r, s);  
+    Swap(qi, t, r, s);  
 
   return 1;
 } 
@@ -92,10 +91,8 @@ void
 Solve(QAPInfo qi)
 {
   int i;
-
-  glob_qi = qi;
  
-  int n = qi->size;
+  int n = qi->inst->size;
 
   QAPVector t = QAP_Alloc_Vector(n);
   for(i = 0; i < n; i++)
@@ -112,7 +109,7 @@ Solve(QAPInfo qi)
   while(Report_Solution(qi))
     {
       qi->iter_no++;
-      if (!Next_Permutation(t, n))
+      if (!Next_Permutation(qi, t, n))
 	break;
     }
 }
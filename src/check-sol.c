@@ -11,30 +11,30 @@ int n;
 QAPInfo qi;
 
 
-int
+QAPCost
 One_Way(int exchange)
 {
   QAPMatrix a, b;
 
   if (!exchange)
     {
-      a = qi->a;
-      b = qi->b;
+      a = qi->inst->a;
+      b = qi->inst->b;
       printf("---------- Original Matrix ----------\n");
     }
   else
     {
-      a = qi->b;
-      b = qi->a;
+      a = qi->inst->b;
+      b = qi->inst->a;
       printf("---------- Exchanged Matrix ----------\n");
     }
 
   int i, j;
-  int cost = 0;
+  QAPCost cost = 0;
   
   for (i = 0; i < n; i++)
     for (j = 0; j < n; j++)
-      cost += a[i][j] * b[p[i]][p[j]];
+      cost += (QAPCost) QAP_Elem(a, i, j) * QAP_Elem(b, p[i], p[j]);
 
   printf("solution (0-based):\n");
   for (i = 0; i < n; i++)
@@ -43,11 +43,11 @@ One_Way(int exchange)
   printf("solution (1-based):\n");
   for (i = 0; i < n; i++)
     printf("%d ", p[i] + 1);
-  printf("\n\nCost: %d\n", cost);
+  printf("\n\nCost: %lld\n", cost);
   if (!exchange)
     {
       printf("\n- - - - format for .sln - - - -\n");
-      printf("%d %d", n, cost);
+      printf("%d %lld", n, cost);
       char c = '\n';
       for (i = 0; i < n; i++)
 	{
@@ -89,7 +89,7 @@ main(int argc, char *argv[])
     }
 
   qi = QAP_Load_Problem(file_name, 0);
-  n = qi->size;
+  n = qi->inst->size;
   
   int based_1 = 1;
   printf("enter the solution (0-based or 1-based is OK)\n");
@@ -110,14 +110,14 @@ main(int argc, char *argv[])
     for (i = 0; i < n; i++)
       p[i]--;
 
-  int c1 = One_Way(exchange);
+  QAPCost c1 = One_Way(exchange);
 
   QAP_Switch_To_Dual_Vector(p, n);
 
-  int c2 = One_Way(!exchange);
+  QAPCost c2 = One_Way(!exchange);
 
   if (c1 != c2)
-    printf("NB: %d != %d\n", c1, c2);
+    printf("NB: %lld != %lld\n", c1, c2);
      
   return c1 != c2;
 }
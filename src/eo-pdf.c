@@ -57,6 +57,8 @@ static void PDF_Compute_Tau_From_Force_Non_Monot(PDF *p);
 
 static void PDF_Compute_Force(PDF *p);
 
+static void PDF_Build_Alias_Table(PDF *p);
+
 static void PDF_Gener_GNUplot(PDF *p);
 
 
@@ -451,12 +453,13 @@ PDF_Init(PDF *p)
 	VERB(2, "Parameter tau set to %g", p->tau);
     }
 
-  if (!isnan(p->force))
+  if (!isnan(p->force) && !PDF_Lookup_Tau(p))
     {
       if (pdf_tbl[pdf_no].force_monot != NON_MONOTONE)
 	PDF_Compute_Tau_From_Force_Monot(p);
       else
 	PDF_Compute_Tau_From_Force_Non_Monot(p);
+      PDF_Store_Tau(p);
     }
 
   int x;
@@ -482,11 +485,80 @@ PDF_Init(PDF *p)
   if (isnan(p->force))
     PDF_Compute_Force(p);
 
+  if (!p->roulette)
+    PDF_Build_Alias_Table(p);
+
   PDF_Gener_GNUplot(p);
 }
 
 
 
+/*
+ *  Cache of the tau computed from a force (the search can be long)
+ *
+ *  A text file, each line is: PDF_NAME SIZE FORCE TAU (the doubles are written
+ *  with %.17g so the force read back is exactly the same). Lines are appended
+ *  when a tau is computed (see also find_tau.c to fill it beforehand).
+ */
+
+/*
+ *  Sets tau from the cache (if any) for the PDF, size and force of p
+ *  Returns 1 if found, 0 otherwise
+ */
+
+int
+PDF_Lookup_Tau(PDF *p)
+{
+  char name[256];
+  int size;
+  double force, tau;
+  FILE *f;
+  int found = 0;
+
+  if (p->tau_cache == NULL || (f = fopen(p->tau_cache, "r")) == NULL)
+    return 0;
+
+  while (!found && fscanf(f, "%255s %d %lf %lf", name, &size, &force, &tau) == 4)
+    if (size == p->size && force == p->force && strcmp(name, p->pdf_name) == 0)
+      found = 1;
+
+  fclose(f);
+
+  if (found)
+    {
+      VERB(2, "Force %g: tau %g read from %s", p->force, tau, p->tau_cache);
+      p->tau = tau;
+    }
+
+  return found;
+}
+
+
+
+/*
+ *  Appends the tau computed for the PDF, size and force of p to the cache (if any)
+ */
+
+void
+PDF_Store_Tau(PDF *p)
+{
+  FILE *f;
+
+  if (p->tau_cache == NULL)
+    return;
+
+  if ((f = fopen(p->tau_cache, "a")) == NULL)
+    {
+      perror(p->tau_cache);
+      return;
+    }
+
+  fprintf(f, "%s %d %.17g %.17g\n", p->pdf_name, p->size, p->force, p->tau);
+  fclose(f);
+}
+
+
+
 /*
  *  Computes tau from force in the case the PDF force is monotone
  *
@@ -700,6 +772,77 @@ PDF_Compute_Force(PDF *p)
 }
 
 
+/*
+ *  Builds the alias table of the PDF (Vose's method, in O(size))
+ *
+ *  The size values are split in size columns of probability 1/size each. Column x
+ *  holds value x with probability alias_prob[x] and value alias[x] for the rest.
+ *  A column is thus filled by a value whose probability is < 1/size (small) and
+ *  completed by a value whose probability is >= 1/size (large) which is then
+ *  reduced accordingly.
+ */
+
+static void
+PDF_Build_Alias_Table(PDF *p)
+{
+  int size = p->size;
+  double *scaled = Malloc(size * sizeof(double)); /* probabilities * size */
+  int *small = Malloc(size * sizeof(int));
+  int *large = Malloc(size * sizeof(int));
+  int n_small = 0, n_large = 0;
+  int x;
+
+  if (p->alias_prob == NULL)
+    {
+      p->alias_prob = Malloc(size * sizeof(double));
+      p->alias = Malloc(size * sizeof(int));
+    }
+
+  for (x = 0; x < size; x++)
+    {
+      scaled[x] = p->pdf_value[x + 1] * size;
+      if (scaled[x] < 1.0)
+	small[n_small++] = x;
+      else
+	large[n_large++] = x;
+    }
+
+  while (n_small > 0 && n_large > 0)
+    {
+      int s = small[--n_small];
+      int l = large[--n_large];
+
+      p->alias_prob[s] = scaled[s];
+      p->alias[s] = l;
+
+      scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+      if (scaled[l] < 1.0)
+	small[n_small++] = l;
+      else
+	large[n_large++] = l;
+    }
+
+  /* the remaining columns are full (up to rounding errors) */
+  while (n_large > 0)
+    {
+      x = large[--n_large];
+      p->alias_prob[x] = 1.0;
+      p->alias[x] = x;
+    }
+
+  while (n_small > 0)
+    {
+      x = small[--n_small];
+      p->alias_prob[x] = 1.0;
+      p->alias[x] = x;
+    }
+
+  Free(scaled);
+  Free(small);
+  Free(large);
+}
+
+
 /*
  *  Emits gnuplot data files
  */
@@ -778,7 +921,10 @@ PDF_Gener_GNUplot(PDF *p)
 /*
  *  Returns an integer in 0..size-1 according to the PDF 
  *
- *  Here we use a roulette-wheel selection in O(n) 
+ *  By default we use the alias table: O(1) with a single random draw
+ *  (the integer part selects a column, the fractional part the value in it).
+ *
+ *  Else (roulette) we use a roulette-wheel selection in O(n) 
  *  (but practically faster since the shape of the PDF)
  *
  *  We could also use a binary search in O(log(size)) 
@@ -789,6 +935,14 @@ PDF_Gener_GNUplot(PDF *p)
 int
 PDF_Pick(PDF *p)
 {
+  if (!p->roulette)
+    {
+      double u = Random_Double() * p->size;
+      int x = (int) u;
+
+      return (u - x < p->alias_prob[x]) ? x : p->alias[x];
+    }
+
   double *pdf_value = p->pdf_value;
   double prob = Random_Double(), fx;
   int x = 0;
@@ -798,6 +952,3 @@ PDF_Pick(PDF *p)
 
   return x - 1;
 }
-
-
-
@@ -20,6 +20,8 @@ typedef struct
   char *pdf_name;		/* name of the PDF (or "random" or NULL) */
   char *gplot_prefix;		/* file name to create gplot files (or NULL) */
   int show_gplot;		/* try to show the created gplot (if gplot_prefix != NULL) */
+  int roulette;			/* PDF_Pick uses a roulette-wheel (else the alias table) */
+  char *tau_cache;		/* file caching the tau computed from a force (or NULL) */
 
   /* input/output */
 
@@ -31,6 +33,8 @@ typedef struct
   int pdf_no;			/* index in the pdf_tbl[] array */
   PDFunc pdf;			/* the probability distribution function */
   double *pdf_value;		/* array of tabled PDF values (NULL or a valid pointer at entry for reuse) */
+  double *alias_prob;		/* alias table: probability to keep x in 0..size-1 (idem, unused if roulette) */
+  int *alias;			/* alias table: the other value if x is not kept (idem) */
   char *pdf_name0;		/* copy of the received PDF name */
   double tau0;			/* copy of the received tau */
   double force0;		/* copy of the received force level */
@@ -47,6 +51,10 @@ char *PDF_Get_Function_Name(int pdf_no);
 
 void PDF_Init(PDF *p);
 
+int PDF_Lookup_Tau(PDF *p);
+
+void PDF_Store_Tau(PDF *p);
+
 int PDF_Pick(PDF *p);
 
 
@@ -15,6 +15,13 @@
  *  or with     : ./eo-qap Data/tai40a.qap -p expon -t 0.2 -m 1000000
  *  or with     : ./eo-qap Data/tai40a.qap -p expon -t 0.2 -m 1000000 -v 1
  *  or n times  : ./eo-qap Data/tai40a.qap -t 1.2 -m 0100000 -b 10
+ *  or threaded : ./eo-qap Data/tai100a.qap -w 0 -m 1000000 -v 1
+ *
+ *  With -w K walkers (0: one per cpu) race on the same instance: each walker
+ *  has its own solving state (solution, delta and row minima), EOContext and
+ *  random stream while the tabled PDF is shared (read-only once initialized).
+ *  They record their improvements in the race (common best) and all stop as
+ *  soon as one reaches the target (see Do_Race in main.c).
  *
  *  The execution can be interrupted with CTRL+C
  */
@@ -39,21 +46,18 @@ static char *g_fname = NULL;		/* default: no graph output */
 static char *g_fname1 = NULL;		/* default: no graph output */
 
 
-static int size;		/* QAP problem size */
-
-
-typedef struct
+typedef struct			/* solving context of a Solve() (one per walker) */
 {
-  int index;
-  int fitness;			/* lambda value = best cost delta if swapped */
-#ifdef FAST_VAR2_SELECTION
-  int index2;
-#endif
-} FitInfo;
+  QAPInfo qi;
+  int size;			/* QAP problem size */
+  QAPCost *fit_sel;		/* work copy of the fitness values (see Fitness_Of_Rank) */
+} EOContext;
 
-static FitInfo *fit_tbl;
+				/* fitness of i: lambda value = best cost delta if i is swapped */
+#define Fitness(ctx, i)  ((ctx)->qi->row_min[i].min)
 
-static PDF pdf;			/* PDF record */
+
+static PDF pdf;			/* PDF record (read-only once initialized: shared by all the walkers) */
 
 
 /*
@@ -77,6 +81,8 @@ Init_Main(void)
   Register_Option("-f", OPT_DBL, "FORCE", "specify PDF force level (in [0:1])", &pdf.force);
   Register_Option("-g", OPT_STR, "FILE",  "generate graph files FILE.{dat,gplot,pdf}", &g_fname);
   Register_Option("-G", OPT_STR, "FILE",  "like -g but also show the graph", &g_fname1);
+  Register_Option("-F", OPT_STR, "FILE",  "cache the tau computed from -f in FILE (see find_tau)", &pdf.tau_cache);
+  Register_Option("-l", OPT_NON, "",      "pick the ranks with a roulette-wheel (instead of an alias table)", &pdf.roulette);
 
 }
 
@@ -86,7 +92,7 @@ Init_Main(void)
  *  Displays parameters
  */
 void
-Display_Parameters(QAPInfo qi, int target_cost)
+Display_Parameters(QAPInfo qi, QAPCost target_cost)
 {
   if (!isnan(pdf.tau))
     {
@@ -95,7 +101,7 @@ Display_Parameters(QAPInfo qi, int target_cost)
       pdf.force = NAN;
     }
 
-  pdf.size = qi->size;
+  pdf.size = qi->inst->size;
   pdf.gplot_prefix = (g_fname1 != NULL) ? g_fname1 : g_fname;
   pdf.show_gplot = (g_fname1 != NULL);
 
@@ -104,57 +110,79 @@ Display_Parameters(QAPInfo qi, int target_cost)
   printf("used PDF      : %s\n", pdf.pdf_name);
   printf("tau parameter : %g\n", pdf.tau);
   printf("force level   : %g\n", pdf.force);
+  printf("rank pick     : %s\n", (pdf.roulette) ? "roulette-wheel" : "alias table");
 }
 
 
 
 
 /*
- *  Selects the first variable to swap (according to fitness and PDF)
- *  Returns the rank in the fitness table
+ *  Returns the fitness of rank k (in ascending order) without sorting the fitness
+ *  (quickselect on a copy of the fitness values: O(size) on average)
  */
-
-static int
-Select_First_Variable(void)
+static QAPCost
+Fitness_Of_Rank(EOContext *ctx, int k)
 {
-#if 0   /* select f with the PDF and one variable among all having this f */
+  QAPCost *v = ctx->fit_sel;
+  int lo = 0, hi = ctx->size - 1;
+  int i;
 
-  int rank = PDF_Pick(&pdf);
-  int f = fit_tbl[rank].fitness;
-  int n_f = 0;
-  int k;
-  int selected_rank = 0;
+  for (i = 0; i <= hi; i++)
+    v[i] = Fitness(ctx, i);
 
-  for(k = 0; k < size; k++)
+  while (lo < hi)
     {
-      if (fit_tbl[k].fitness > f)	/* fit_tbl[] is in ascending order */
-	break;
+      QAPCost pivot = v[(lo + hi) / 2];
+      int l = lo, h = hi;
+
+      while (l <= h)
+	{
+	  while (v[l] < pivot)
+	    l++;
+	  while (v[h] > pivot)
+	    h--;
+	  if (l <= h)
+	    {
+	      QAPCost x = v[l];
+	      v[l++] = v[h];
+	      v[h--] = x;
+	    }
+	}
 
-      if (fit_tbl[k].fitness == f && Random(++n_f) == 0)
-	selected_rank = k;
+      if (k <= h)
+	hi = h;
+      else if (k >= l)
+	lo = l;
+      else			/* h < k < l: v[k] == pivot */
+	break;
     }
 
-  return selected_rank;
+  return v[k];
+}
 
-#elif 1  /* select f with the PDF and one variable among all having this f */
 
-  int rank = PDF_Pick(&pdf);
-  int f = fit_tbl[rank].fitness;
-  int k_deb = rank, k_end = rank;
+/*
+ *  Selects the first variable to swap (according to fitness and PDF)
+ *
+ *  Select f with the PDF (f is the fitness of the picked rank, i.e. in the
+ *  table of fitness sorted in ascending order) and one variable among all
+ *  having this f. Only the fitness of the rank is needed (no sort).
+ */
+static int
+Select_First_Variable(EOContext *ctx)
+{
+  QAPCost f = Fitness_Of_Rank(ctx, PDF_Pick(&pdf));
+  int n_f = 0;
+  int i, k;
 
-  while(--k_deb >= 0 && fit_tbl[k_deb].fitness == f)
-    ;
+  for (i = 0; i < ctx->size; i++)
+    n_f += (Fitness(ctx, i) == f);
 
-  while(++k_end < size && fit_tbl[k_end].fitness == f)
+  k = Random(n_f);
+  for (i = 0; Fitness(ctx, i) != f || k-- > 0; i++)
     ;
 
-  return Random_Interval(k_deb + 1, k_end - 1);
-
-#else  /* select f with the PDF and the associated variable  */
-
-  return PDF_Pick(&pdf);
-
-#endif
+  return i;
 }
 
 
@@ -164,21 +192,22 @@ Select_First_Variable(void)
  *  We propose to use a the min-conflict heuristics
  */
 static int
-Select_Second_Variable(QAPInfo qi, int i, int selected_rank)
+Select_Second_Variable(EOContext *ctx, int i)
 {
 #ifndef FAST_VAR2_SELECTION
 
+  QAPInfo qi = ctx->qi;
   int j;
   int min_j = 0;
-  int min_cost = INT_MAX;
+  QAPCost min_cost = QAP_COST_MAX;
   int min_nb = 0;
 
-  for (j = 0; j < size; j++)
+  for (j = 0; j < ctx->size; j++)
     {
       if (i == j)
 	continue;
 
-      int c = QAP_Cost_If_Swap(qi, i, j);
+      QAPCost c = QAP_Cost_If_Swap(qi, i, j);
 
       if (c < min_cost)
 	{
@@ -191,46 +220,37 @@ Select_Second_Variable(QAPInfo qi, int i, int selected_rank)
     }
 
 #if 0
-  int c = QAP_Cost_If_Swap(qi, i, fit_tbl[selected_rank].index2);
+  QAPCost c = QAP_Cost_If_Swap(qi, i, ctx->qi->row_min[i].arg);
   if (c != min_cost)
-    printf("STRANGE: %d != %d\n", min_cost, c);
+    printf("STRANGE: %lld != %lld\n", min_cost, c);
 #endif
 
   return min_j;
 
 #else
 
-  int j = fit_tbl[selected_rank].index2;
-  return j;
+  return ctx->qi->row_min[i].arg;
 
 #endif
 }
 
 
-/*
- *  Comparator used by qosrt(3) to sort the table of fitness
- */
-static int
-CmpFitForSort(const void *x, const void *y)
-{
-  FitInfo *p1 = (FitInfo *) x;
-  FitInfo *p2 = (FitInfo *) y;
-
-  return p1->fitness - p2->fitness;	/* ascending order */
-}
-
-
-
-
 /*
  *  General solving procedure
  */
 void
 Solve(QAPInfo qi)
 {
-  size = qi->size;
-  
-  fit_tbl = Malloc(size * sizeof(fit_tbl[0]));
+  EOContext context, *ctx = &context;
+  int size = qi->inst->size;
+
+  ctx->qi = qi;
+  ctx->size = size;
+  ctx->fit_sel = Malloc(size * sizeof(ctx->fit_sel[0]));
+
+  /* the fitness of i is the min of the row i of delta (and index2 a random j
+   * giving this min): they are maintained as a by-product of the delta update */
+  QAP_Track_Row_Minima(qi, Random);
   
   qi->iter_no = 0;
   while (Report_Solution(qi)) 
@@ -238,48 +258,12 @@ Solve(QAPInfo qi)
       qi->iter_no++;
       int i, j;
 
-      for (i = 0; i < size; i++)
-	{
-	  int f = INT_MAX;
-#ifdef FAST_VAR2_SELECTION
-	  int i2 = 0;
-	  int nb_i2 = 0;
-#endif	  
-	  for (j = 0; j < size; j++)
-	    {
-	      if (i == j)
-		continue;
-	      int d = QAP_Get_Delta(qi, i, j);
-
-	      if (d < f)
-		{
-		  f = d;
-#ifdef FAST_VAR2_SELECTION
-		  i2 = j;
-		  nb_i2 = 1;
-		}
-	      else if (f == d && Random(++nb_i2) == 0)
-		{
-		  i2 = j;
-#endif
-		}
-	    }
-
-	  fit_tbl[i].index = i;
-	  fit_tbl[i].fitness = f;
-#ifdef FAST_VAR2_SELECTION
-	  fit_tbl[i].index2 = i2;
-#endif
-	}
-
-      qsort(fit_tbl, size, sizeof(FitInfo), CmpFitForSort);
-
-      int selected_rank = Select_First_Variable();
-      i = fit_tbl[selected_rank].index;
-      j = Select_Second_Variable(qi, i, selected_rank);
+      i = Select_First_Variable(ctx);
+      j = Select_Second_Variable(ctx, i);
 
       QAP_Do_Swap(qi, i, j); /* register the swap */
     }
 
-  Free(fit_tbl);
+  QAP_Track_Row_Minima(qi, NULL);
+  Free(ctx->fit_sel);
 }
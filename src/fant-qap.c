@@ -68,7 +68,7 @@ Init_Main(void)
  *  Display parameters
  */
 void
-Display_Parameters(QAPInfo qi, int target_cost)
+Display_Parameters(QAPInfo qi, QAPCost target_cost)
 {
   printf("R parameter   : %d\n", R);
 }
@@ -81,9 +81,9 @@ void swap(int *a, int *b) {int temp = *a; *a = *b; *b = temp;}
 // Perform improvements as soon as they are found
 void local_search(QAPInfo qi, QAPVector move)
 {
-  int n = qi->size;		/* problem size */
+  int n = qi->inst->size;		/* problem size */
   int r, s, i, j, scan_nr, nr_moves;
-  int delta;
+  QAPCost delta;
   nr_moves = 0;
   for (i = 0; i < n-1; i++)
     for (j=i+1; j < n; j++)
@@ -120,7 +120,7 @@ void init_trace(int n, int increment, QAPMatrix trace)
  {int i, j;
   for (i = 0; i < n; i++) 
     for (j = 0; j < n; j++)
-      trace[i][j] = increment;
+      QAP_Elem(trace, i, j) = increment;
  }
 
 // memory update
@@ -137,8 +137,8 @@ int update_trace(int n, QAPVector p, QAPVector best_p,
   else
     for (i = 0; i < n; i++)
       {
-	trace[i][p[i]] += increment;
-	trace[i][best_p[i]] += R;
+	QAP_Elem(trace, i, p[i]) += increment;
+	QAP_Elem(trace, i, best_p[i]) += R;
       }
   return increment;
 }
@@ -148,7 +148,7 @@ int update_trace(int n, QAPVector p, QAPVector best_p,
 void generate_solution_trace(QAPInfo qi, QAPMatrix trace,
 			     QAPVector nexti, QAPVector nextj, QAPVector sum_trace)
 {
-  int n = qi->size;
+  int n = qi->inst->size;
   QAPVector p = qi->sol;
   int i, j, k, target, sum;
   
@@ -158,22 +158,23 @@ void generate_solution_trace(QAPInfo qi, QAPMatrix trace,
     {
       sum_trace[i] = 0;
       for (j = 0; j < n; j++)
-	sum_trace[i] += trace[i][j];
+	sum_trace[i] += QAP_Elem(trace, i, j);
     }
 
   for (i = 0; i < n; i++)
     {
       target = Random_Interval(0, sum_trace[nexti[i]]-1);
       j = i;
-      sum = trace[nexti[i]][nextj[j]];
+      int *trace_i = QAP_Row(trace, nexti[i]);
+      sum = trace_i[nextj[j]];
       while (sum < target)
 	{
 	  j++;
-	  sum += trace[nexti[i]][nextj[j]];
+	  sum += trace_i[nextj[j]];
 	}
       p[nexti[i]] = nextj[j];
       for (k = i; k <n; k++)
-	sum_trace[nexti[k]] -= trace[nexti[k]][nextj[j]];
+	sum_trace[nexti[k]] -= QAP_Elem(trace, nexti[k], nextj[j]);
       swap(&nextj[j], &nextj[i]);
     }
 }
@@ -187,8 +188,8 @@ void generate_solution_trace(QAPInfo qi, QAPMatrix trace,
 void
 Solve(QAPInfo qi)
 {
-  int n = qi->size;		/* problem size */
-  int best_cost;                    // cost of current solution, best cost
+  int n = qi->inst->size;		/* problem size */
+  QAPCost best_cost;                // cost of current solution, best cost
   QAPVector p = qi->sol;             // current solution
   QAPVector best_p;                  // best solution
   QAPMatrix trace;                      // ant memory
@@ -197,7 +198,7 @@ Solve(QAPInfo qi)
   QAPVector nexti, nextj, sum_trace;
 
   best_p = QAP_Alloc_Vector(n);	/*  must be different from p, OK since initialized with 0, */
-  best_cost = INT_MAX;
+  best_cost = QAP_COST_MAX;
 
   trace = QAP_Alloc_Matrix(n);
   increment = 1;
@@ -236,7 +237,7 @@ Solve(QAPInfo qi)
 
   // ending the programme
   QAP_Free_Vector(best_p);
-  QAP_Free_Matrix(trace, n);
+  QAP_Free_Matrix(trace);
   QAP_Free_Vector(move);
   QAP_Free_Vector(nexti);
   QAP_Free_Vector(nextj);
@@ -0,0 +1,88 @@
+/*
+ *  Extended Extremal Optimization
+ *
+ *  Copyright (C) 2015-2022 Daniel Diaz
+ *
+ *  find_tau.c: precompute the tau of PDF force levels into a cache file
+ */
+
+
+/*
+ *  compile with: make find_tau
+ *
+ *  execute with: ./find_tau tau.cache 40,50,100 0.4,0.6
+ *  or with     : ./find_tau tau.cache 40 0.5 gamma,power
+ *
+ *  Then eo-qap -F tau.cache -f FORCE ... finds its tau in the cache
+ *  instead of searching it (see PDF_Lookup_Tau in eo-pdf.c).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "tools.h"
+#include "eo-pdf.h"
+
+
+int
+Get_Verbose_Level(void)		/* needed by eo-pdf.c (see main.h) */
+{
+  return 0;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  char sizes[1024], forces[1024], pdfs[1024], names[1024];
+  char *s, *f, *n;
+  char *save_s, *save_f, *save_n;
+  int i;
+
+  if (argc < 4)
+    {
+      fprintf(stderr, "Usage: %s CACHE_FILE SIZE,... FORCE,... [PDF,...]\n", argv[0]);
+      fprintf(stderr, "PDF (default all):");
+      for (i = 0; i < PDF_Get_Number_Of_Functions(); i++)
+	fprintf(stderr, " %s", PDF_Get_Function_Name(i));
+      fprintf(stderr, "\n");
+      exit(1);
+    }
+
+  *pdfs = '\0';
+  if (argc > 4)
+    snprintf(pdfs, sizeof(pdfs), "%s", argv[4]);
+  else
+    for (i = 0; i < PDF_Get_Number_Of_Functions(); i++)
+      sprintf(pdfs + strlen(pdfs), "%s%s", (i > 0) ? "," : "", PDF_Get_Function_Name(i));
+
+  snprintf(sizes, sizeof(sizes), "%s", argv[2]);
+  for (s = strtok_r(sizes, ",", &save_s); s != NULL; s = strtok_r(NULL, ",", &save_s))
+    {
+      snprintf(forces, sizeof(forces), "%s", argv[3]);
+      for (f = strtok_r(forces, ",", &save_f); f != NULL; f = strtok_r(NULL, ",", &save_f))
+	{
+	  snprintf(names, sizeof(names), "%s", pdfs);
+	  for (n = strtok_r(names, ",", &save_n); n != NULL; n = strtok_r(NULL, ",", &save_n))
+	    {
+	      PDF p;
+
+	      memset(&p, 0, sizeof(p));
+	      p.size = atoi(s);
+	      p.pdf_name = n;
+	      p.tau = NAN;
+	      p.force = atof(f);
+	      p.roulette = 1;	/* no alias table */
+	      p.tau_cache = argv[1];
+
+	      PDF_Init(&p);	/* reads the cache or computes tau and adds it */
+	      printf("%-12s size: %4d  force: %g  tau: %.17g\n", p.pdf_name, p.size, p.force, p.tau);
+	      Free(p.pdf_value);
+	    }
+	}
+    }
+
+  return 0;
+}
@@ -11,6 +11,9 @@
 #include <string.h>
 #include <signal.h>
 #include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #define _MAIN_C
 
@@ -30,7 +33,7 @@ typedef struct
 
 static Option option[128];
 static int n_option = 0;
-static int target_cost;
+static QAPCost target_cost;
 
 
 static char *file_name;
@@ -39,26 +42,125 @@ static double prob_reuse = 0.0;
 static int n_execs = 1;
 static int read_initial = 0;
 static int verbose = 0;
-static int max_exec_iters = 10000;
-static int max_restart_iters = INT_MAX;
-static int run_no;
+static Limit exec_limit = { -1, 0.0, 0 };	/* default: 10000 iters (no limit if a time is given) */
+static Limit restart_limit = { INT_MAX, 0.0, 0 };
+static long long exec_max_iters;	/* exec_limit.iters (LLONG_MAX if only limited by a time) */
+static char *restart_policy_spec = "fixed";
+static int cpu_limits = 0;
+static char *kernel_name = NULL;
+static int use_permuted_b = 0;
+static int use_transpose = 0;
+static int no_narrow = 0;
+static int use_cost64 = 0;
+static double sparse_density = QAP_SPARSE_DENSITY;
+static int delta_threads = -1;
+static int n_threads = 0;
+static int n_walkers = -1;
+static int perturb_swaps = 0;
+static int perturb_best = 0;
+static int perturb_adapt = 0;
+static int elite_size = 0;
+static int migration_iters = 1000;
+static int (*get_nb_walkers)(void) = NULL;	/* see Register_Walkers */
+static char *(*get_walker_name)(int walker_no) = NULL;
+static char *option_prefix = NULL;		/* see Set_Option_Prefix */
 
 static int ctrl_c = 0;
 
-// execution vars
+enum				/* restart policies (-L): #iters of the run k (k = 0, 1,...) with ITERS given by -r */
+{
+  RESTART_FIXED,		/* ITERS */
+  RESTART_LUBY,			/* ITERS * luby(k + 1): 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8... */
+  RESTART_GEOM,			/* ITERS * FACTOR^k */
+  RESTART_RATE			/* as long as run_best_cost improves by >= RATE (relative) every ITERS iters */
+};
+
+static char *restart_policy_name[] = { "fixed", "luby", "geom", "rate" };
+static int restart_policy = RESTART_FIXED;
+static double restart_param;	/* FACTOR (geom) or RATE (rate) */
+
+// execution vars (one copy per thread with -j, the matrices of qi are shared)
+
+static QAPInfo qi_main;		/* the loaded problem (qi of the main thread) */
 
-static QAPInfo qi;
+static __thread QAPInfo qi;
+static __thread int run_no;
+static __thread int sol_is_set;	/* are the delta and cost of qi those of qi->sol ? (no QAP_Set_Solution needed) */
+static __thread int perturb_k;	/* current perturbation strength (-k, see -A) */
+static __thread QAPVector restart_sol;	/* work vectors for the restarts (those of the Walker in a walker thread) */
+static __thread QAPVector restart_pos;
 
 /* can do n execs, each exec is composed of m runs of the method (1 run = first + restarts)
  */
 
-static QAPVector run_best_sol; /* inside 1 bench exec and 1 run:  (record best of sol[]) */
-static int run_best_cost;
-static QAPVector exec_best_sol;	/* inside 1 exec, best of all runs */
+static __thread QAPVector run_best_sol; /* inside 1 bench exec and 1 run:  (record best of sol[]) */
+static __thread QAPVector exec_best_sol;	/* inside 1 exec, best of all runs */
+				/* run_best_cost and exec_iters are in report_state (see main.h) */
 
-static int exec_no;		/* 1 bench exec can include several runs */
-static int exec_iters = 0;	/* total #iters in one bench exec */
-static int exec_best_cost;	/* best cost in one bench exec (accross all runs) */
+static __thread int exec_no;	/* 1 bench exec can include several runs */
+static __thread long long exec_total_iters; /* #iters of the exec (of all the walkers of a race) */
+static __thread int run_max_iters;	/* #iters of the current run (see Restart_Max_Iters) */
+static __thread int run_improved_iter;	/* iter_no of the last improvement of run_best_cost */
+static __thread long long rate_next_check; /* RESTART_RATE: iter_no of the next check of the improvement */
+static __thread QAPCost rate_check_cost; /* RESTART_RATE: run_best_cost at the previous check */
+static __thread QAPCost exec_best_cost;	/* best cost in one bench exec (accross all runs) */
+
+typedef struct
+{
+  unsigned seq;			/* even: stable, odd: being written (see Seq_Write_Begin) */
+  QAPCost cost;			/* QAP_COST_MAX: empty slot */
+  QAPVector sol;
+} EliteSlot;
+
+typedef struct			/* bounded lock-free pool of elite solutions shared by islands (-E) */
+{
+  int nb_slots;
+  EliteSlot *slot;
+} ElitePool;
+
+				/* island restarts from an elite perturbed by size * ELITE_PERTURB_RATIO swaps */
+#define ELITE_PERTURB_RATIO  0.1
+
+typedef struct
+{
+  QAPCost best_cost;		/* best cost found by the walkers of the race (atomic) */
+  unsigned best_seq;		/* seqlock of the best solution below (see Seq_Write_Begin) */
+  QAPCost best_sol_cost;	/* cost of best_sol (lags behind best_cost while it is written) */
+  int best_walker;		/* walker having found best_sol first */
+  long best_real_time;		/* time at which best_sol was found (msecs) */
+  QAPVector best_sol;		/* best solution of the race */
+  int winner;			/* first walker having reached the target (-1: none) */
+  long winner_real_time;	/* time at which the winner reached the target (msecs) */
+  int stop;			/* the target is reached: all walkers stop */
+  ElitePool *pool;		/* elite pool of the islands (or NULL) */
+} Race;
+
+typedef struct
+{
+  Race *race;
+  int race_exec_no;
+  int walker_no;
+  QAPInfo qi;			/* own solving vars of the walker */
+  QAPVector best_sol;		/* best solution of the walker */
+  QAPVector run_best_sol;
+  QAPVector restart_sol;	/* work vectors of Do_Runs (a walker thread only lives for a race) */
+  QAPVector restart_pos;
+  int nb_runs;
+  long long nb_iters;
+  double user_time;		/* user time of the walker thread (-j) */
+} Walker;
+
+static __thread Race *race = NULL; /* race of the calling thread (-w) */
+static __thread int walker_no = 0;
+static int *race_wins = NULL;	/* #races won by each walker */
+static __thread Walker *walker_tbl = NULL; /* walkers of the races started by this thread */
+static __thread ElitePool *elite_pool = NULL; /* pool of the races started by this thread */
+static __thread QAPVector race_best_sol = NULL; /* best solution of the races started by this thread */
+static __thread long long next_migration; /* exec_iters of the next migration to the pool */
+static __thread QAPCost migrated_cost; /* last run_best_cost sent to the pool */
+
+static int next_exec_no;	/* next exec to start (-j) */
+static pthread_mutex_t stat_mutex = PTHREAD_MUTEX_INITIALIZER; /* protects the statistics (-j) */
 
 #if 0
 static int sum_iters = 0;
@@ -67,24 +169,55 @@ static int max_iters = 0;
 #endif
 
 static double sum_cost = 0.0;
-static int min_cost = INT_MAX;
-static int max_cost = 0;
-
-static double time_at_start;
+static long long sum_iters = 0;
+static long long sum_runs = 0;
+static int nb_bks_hits = 0;	/* #execs having reached the BKS (or the optimum) */
+static QAPCost min_cost = QAP_COST_MAX;
+static QAPCost max_cost = 0;
+
+static __thread double time_at_start;
+static __thread long exec_deadline;	/* Limit_Time() at which the exec stops (LONG_MAX: none) */
+static __thread long run_deadline;	/* Limit_Time() at which the run stops (<= exec_deadline) */
+static __thread int time_out;	/* 1: run_deadline reached, 2: exec_deadline reached */
 static double sum_time = 0.0;
 static double min_time = INT_MAX;
 static double max_time = 0.0;
 
 
 
+				/* with -j an exec only counts the user time of its thread (the main thread: of all) */
+#define Exec_User_Time() ((n_threads > 0 && qi != qi_main) ? Thread_User_Time() : User_Time())
+
+#define Init_Elapsed_Time() (time_at_start = (double) Exec_User_Time())
+
+#define Get_Elapsed_Time() (((double) Exec_User_Time() - time_at_start) / 1000)
 
-#define Init_Elapsed_Time() (time_at_start = (double) User_Time())
+				/* clock of the time limits (msecs): a walker of a race counts its own thread */
+#define Limit_Time() ((!cpu_limits) ? Coarse_Real_Time() : (n_threads > 0 || race != NULL) ? Thread_User_Time() : User_Time())
 
-#define Get_Elapsed_Time() (((double) User_Time() - time_at_start) / 1000)
+#define TIME_CHECK_ITERS  16	/* the time limits (and CTRL+C, races) are checked every TIME_CHECK_ITERS iterations (power of 2) */
+#define CPU_TIME_CHECK_ITERS 512 /* with -c the clock is a getrusage syscall: the time limits are checked less often (power of 2) */
+
+				/* a run ends after RUN_MAX_ITERS iters: iter_no (+ a tabu tenure...) cannot overflow */
+#define RUN_MAX_ITERS  (INT_MAX / 2)
 
 
 static void Parse_Cmd_Line(int argc, char *argv[]);
 
+static void Parse_Restart_Policy(void);
+
+static void Do_Runs(void);
+
+static void Do_Exec(void);
+
+static double Do_Race(void);
+
+static void *Exec_Thread(void *arg);
+
+static void Island_Migrate(void);
+
+static QAPCost Race_Get_Best(QAPVector sol, int size);
+
 static void Ctrl_C_Handler(int sig);
 
 
@@ -101,29 +234,95 @@ main(int argc, char *argv[])
   Register_Option("-i", OPT_NON, "",                     "read initial configuration", &read_initial);
   Register_Option("-b", OPT_INT, "N_EXECS",              "execute the bench N_EXECS times",  &n_execs);
   Register_Option("-P", OPT_DBL, "PROB_REUSE",           "probability to reuse curr configuration for next execution", &prob_reuse);
-  Register_Option("-T", OPT_INT, "TARGET",               "set target (default: stop when the OPT or BKS is reached)", &target_cost);
+  Register_Option("-T", OPT_COST, "TARGET",              "set target (default: stop when the OPT or BKS is reached)", &target_cost);
   Register_Option("-v", OPT_INT, "LEVEL",                "set verbosity level",  &verbose);
-  Register_Option("-m", OPT_INT, "MAX_ITERS",            "set maximum #iterations", &max_exec_iters); 
-  Register_Option("-r", OPT_INT, "ITERS_BEFORE_RESTART", "set #iterations before restart", &max_restart_iters); 
+  Register_Option("-m", OPT_LIMIT, "MAX_ITERS",          "set maximum #iterations (or time if XXXs, both can be given, default 10000 iters)", &exec_limit); 
+  Register_Option("-r", OPT_LIMIT, "ITERS_BEFORE_RESTART", "set #iterations before restart (+ITERS: without improvement, or time if XXXs, both can be given)", &restart_limit); 
+  Register_Option("-k", OPT_INT, "SWAPS",                "restart from the current solution perturbed by SWAPS random swaps (default 0: random restart)", &perturb_swaps);
+  Register_Option("-B", OPT_NON, "",                     "with -k perturb the best solution of the exec (of the race with -w) instead of the current one", &perturb_best);
+  Register_Option("-A", OPT_NON, "",                     "with -k adapt SWAPS: +25% after a run without exec improvement, reset after an improvement", &perturb_adapt);
+  Register_Option("-L", OPT_STR, "POLICY",               "restart policy with ITERS of -r: fixed luby geom[:FACTOR] rate[:RATE] (default fixed)", &restart_policy_spec);
+  Register_Option("-c", OPT_NON, "",                     "time limits (-m XXXs, -r XXXs) count the CPU time (default: wall-clock)", &cpu_limits);
+  Register_Option("-K", OPT_STR, "KERNEL",               "delta update kernel: scalar avx2 avx512 (default: best supported)", &kernel_name);
+  Register_Option("-C", OPT_NON, "",                     "maintain the permuted distance matrix B[p[i]][p[j]]", &use_permuted_b);
+  Register_Option("-X", OPT_NON, "",                     "keep transposed matrices A^T and B^T (asymmetric instances)", &use_transpose);
+  Register_Option("-N", OPT_NON, "",                     "do not store small-valued matrices on 8/16 bits", &no_narrow);
+  Register_Option("-W", OPT_NON, "",                     "use 64-bit costs (default: only if an int could overflow)", &use_cost64);
+  Register_Option("-S", OPT_DBL, "DENSITY",              "use the sparse flow matrix engine if the density of A <= DENSITY (default 0.05, 0: never)", &sparse_density);
+  Register_Option("-D", OPT_INT, "THREADS",              "#threads computing the whole delta matrix at (re)starts (0: #cpus, default: #cpus, 1 with -j)", &delta_threads);
+  Register_Option("-j", OPT_INT, "THREADS",              "run the execs on THREADS threads (exec #k uses seed SEED+k-1)", &n_threads);
+  Register_Option("-w", OPT_INT, "WALKERS",              "race WALKERS copies of the solver in each exec (stop all when one reaches the target, 0: #cpus / #threads of -j, default: 1 or the solver mix)", &n_walkers);
+  Register_Option("-E", OPT_INT, "POOL_SIZE",            "walkers are islands sharing an elite pool of POOL_SIZE solutions (restart from a perturbed elite)", &elite_size);
+  Register_Option("-e", OPT_INT, "ITERS",                "islands send their run best to the elite pool every ITERS iterations (default 1000)", &migration_iters);
 
   
   Init_Main();
 
   Parse_Cmd_Line(argc, argv);
 
-  if (max_restart_iters > max_exec_iters)
-    max_restart_iters = max_exec_iters;
+  if (exec_limit.iters < 0)
+    exec_limit.iters = (exec_limit.secs > 0) ? INT_MAX : 10000;
+  exec_max_iters = (exec_limit.iters == INT_MAX && exec_limit.secs > 0) ? LLONG_MAX : exec_limit.iters;
+  if (exec_limit.stagnation)
+    {
+      fprintf(stderr, "-m +ITERS is not supported (only -r +ITERS)\n");
+      exit(1);
+    }
+  Parse_Restart_Policy();
+  if (restart_limit.iters > exec_limit.iters)
+    restart_limit.iters = exec_limit.iters;
+
+  if (kernel_name != NULL)
+    {
+      int kernel_no = QAP_Find_Kernel(kernel_name);
+      if (kernel_no < 0)
+	{
+	  fprintf(stderr, "unknown kernel %s (-h for a help)\n", kernel_name);
+	  exit(1);
+	}
+      if (QAP_Select_Kernel(kernel_no) != kernel_no)
+	fprintf(stderr, "Warning: kernel %s is not supported, using %s\n", kernel_name, QAP_Get_Kernel_Name());
+    }
 
   setlinebuf(stdout);
   //setvbuf(stdout, NULL, _IOLBF, 0);  // Windows
 
-  qi = QAP_Load_Problem(file_name, 0);
-  int size = qi->size;
+  QAP_Set_Sparse_Density(sparse_density);
+  if (n_walkers == 0)		/* one walker per cpu (all share the instance), the -j threads share the cpus */
+    {
+      n_walkers = sysconf(_SC_NPROCESSORS_ONLN) / ((n_threads > 0) ? n_threads : 1);
+      if (n_walkers < 1)
+	n_walkers = 1;
+    }
+  if (n_walkers <= 0)
+    n_walkers = (get_nb_walkers != NULL) ? (*get_nb_walkers)() : 1;
+  if (delta_threads < 0)
+    delta_threads = (n_threads > 0 || n_walkers > 1) ? 1 : 0;
+  QAP_Set_Delta_Threads(delta_threads);
+  if (n_threads > 0 && read_initial)
+    {
+      fprintf(stderr, "-i cannot be used with -j\n");
+      exit(1);
+    }
+  if (elite_size > 0 && n_walkers <= 1)
+    {
+      fprintf(stderr, "-E needs several walkers (-w WALKERS with WALKERS > 1)\n");
+      exit(1);
+    }
+  if (migration_iters <= 0)
+    {
+      fprintf(stderr, "-e ITERS must be > 0\n");
+      exit(1);
+    }
+
+  qi_main = qi = QAP_Load_Problem(file_name, ((use_permuted_b) ? QAP_LOAD_PERMUTED_B : 0) | ((use_transpose) ? QAP_LOAD_TRANSPOSE : 0) |
+			((no_narrow) ? QAP_LOAD_NO_NARROW : 0) | ((use_cost64) ? QAP_LOAD_COST64 : 0));
+  int size = qi->inst->size;
 
   if (target_cost <= 0)
-    target_cost = (qi->opt > 0) ? qi->opt : (qi->bks > 0) ? qi->bks : qi->bound;
-  if (target_cost < qi->bound)
-    target_cost = qi->bound;
+    target_cost = (qi->inst->opt > 0) ? qi->inst->opt : (qi->inst->bks > 0) ? qi->inst->bks : qi->inst->bound;
+  if (target_cost < qi->inst->bound)
+    target_cost = qi->inst->bound;
 
   printf("command-line:");
   int i;
@@ -142,17 +341,53 @@ main(int argc, char *argv[])
   printf("\n");
   printf("Used seed: %d\n", seed);
   printf("QAP infos: ");
-  printf(" size:%d ", qi->size);
-  if (qi->opt > 0)
-    printf(" opt: %d ", qi->opt);
-  else if (qi->bound > 0)
-    printf(" bound: %d ", qi->bound);
-  if (qi->bks > 0)
-    printf(" bks: %d", qi->bks);
+  printf(" size:%d ", qi->inst->size);
+  if (qi->inst->opt > 0)
+    printf(" opt: %lld ", qi->inst->opt);
+  else if (qi->inst->bound > 0)
+    printf(" bound: %lld ", qi->inst->bound);
+  if (qi->inst->bks > 0)
+    printf(" bks: %lld", qi->inst->bks);
+  if (qi->inst->symmetric)
+    printf(" symmetric%s", (qi->inst->zero_diag) ? " (zero diagonal)" : "");
   printf("\n");
-  printf("Stop when cost <= %d\n", target_cost);
-  printf("max iterations: %d\n", max_exec_iters);
-  printf("restart iters : %d\n", max_restart_iters);
+  printf("Stop when cost <= %lld\n", target_cost);
+  printf("max iterations: %d\n", exec_limit.iters);
+  if (exec_limit.secs > 0)
+    printf("max time      : %g sec (%s)\n", exec_limit.secs, (cpu_limits) ? "cpu" : "wall-clock");
+  printf("restart iters : %d%s\n", restart_limit.iters, (restart_limit.stagnation) ? " without improvement" : "");
+  if (perturb_swaps > 0)
+    printf("restart from  : %s solution perturbed by %d swaps%s\n", (perturb_best) ? "best" : "current", perturb_swaps,
+	   (perturb_adapt) ? " (adaptive)" : "");
+  if (restart_policy != RESTART_FIXED)
+    printf("restart policy: %s", restart_policy_name[restart_policy]);
+  if (restart_policy == RESTART_GEOM || restart_policy == RESTART_RATE)
+    printf(" (%s %g)", (restart_policy == RESTART_GEOM) ? "factor" : "rate", restart_param);
+  if (restart_policy != RESTART_FIXED)
+    printf("\n");
+  if (restart_limit.secs > 0)
+    printf("restart time  : %g sec (%s)\n", restart_limit.secs, (cpu_limits) ? "cpu" : "wall-clock");
+  printf("delta kernel  : %s (%s matrices%s)%s%s%s\n", QAP_Get_Kernel_Name(), QAP_Get_Width_Name(qi),
+	 (qi->inst->cost64) ? ", 64-bit costs" : "",
+	 (qi->inst->a_csr != NULL) ? " + sparse flow matrix" : "",
+	 (qi->pb != NULL) ? " + permuted distance matrix" : "",
+	 (qi->inst->bt != NULL) ? " + transposed matrices" : "");
+
+  if (n_threads > n_execs)
+    n_threads = n_execs;
+  if (n_threads > 0)
+    printf("exec threads  : %d\n", n_threads);
+  if (n_walkers > 1)
+    {
+      printf("race walkers  : %d", n_walkers);
+      if (get_walker_name != NULL)
+	for (i = 0; i < n_walkers; i++)
+	  printf(" %s", (*get_walker_name)(i));
+      printf("\n");
+      race_wins = Calloc(n_walkers, sizeof(int));
+      if (elite_size > 0)
+	printf("elite pool    : %d solutions, migration every %d iters\n", elite_size, migration_iters);
+    }
 
   Display_Parameters(qi, target_cost);
   
@@ -162,7 +397,7 @@ main(int argc, char *argv[])
   exec_no = 0;
 
   sum_cost = 0.0;
-  min_cost = INT_MAX;
+  min_cost = QAP_COST_MAX;
   max_cost = 0;
 
   sum_time = 0.0;
@@ -171,121 +406,805 @@ main(int argc, char *argv[])
 
   ctrl_c = 0;
 
-  for (exec_no = 0; exec_no < n_execs && !Is_Interrupted(); exec_no++)
+  long real_time_at_start = Real_Time();
+  long user_time_at_start = User_Time();
+
+  Init_Elapsed_Time();		/* with -j: the times of the summary (no exec in this thread) */
+  signal(SIGINT, Ctrl_C_Handler);
+  if (n_threads > 0)
     {
+      pthread_t *thread = Malloc(n_threads * sizeof(pthread_t));
+
+      next_exec_no = 0;
+      for (i = 0; i < n_threads; i++)
+	if (pthread_create(&thread[i], NULL, Exec_Thread, NULL) != 0)
+	  Fatal_Error("cannot create exec thread %d\n", i);
+
+      for (i = 0; i < n_threads; i++)
+	pthread_join(thread[i], NULL);
+
+      Free(thread);
+      exec_no = (next_exec_no < n_execs) ? next_exec_no : n_execs;
+    }
+  else
+    for (exec_no = 0; exec_no < n_execs && !Is_Interrupted(); exec_no++)
+      {
 #if 1
-      int reuse = 0;
-      if (read_initial)
+	int reuse = 0;
+	if (read_initial)
+	  {
+	    if (!Read_Values(qi->sol, size))
+	      return 1;
+	    sol_is_set = 0;
+	  }
+	else if (exec_no == 0 || Random_Double() >= prob_reuse)
+	  {
+	    Random_Permut(qi->sol, size, NULL, 0);
+	    sol_is_set = 0;
+	  }
+	else
+	  reuse = 1;		/* qi is unchanged since the end of the previous exec */
+
+	if (n_execs > 1)
+	  printf("exec #%d %s\n", exec_no + 1, (reuse) ? "(reuse previous configuration)" : "");
+#endif
+	Do_Exec();
+      }
+  signal(SIGINT, SIG_DFL);
+
+  n_execs = exec_no;		/* in case of CTRL_C fix the number of execs (for average) */
+  double avg_cost = sum_cost / n_execs;
+  double avg_time = sum_time / n_execs;
+  if (n_execs > 1)
+    {
+      printf("\n#execs: %d\n", n_execs);
+      printf("Cost: Min:%s  Avg:%s  Max:%s\n", 
+	     Format_Cost_And_Gap(min_cost, target_cost), 
+	     Format_Cost_And_Gap(avg_cost, target_cost), 
+	     Format_Cost_And_Gap(max_cost, target_cost));
+      printf("Time: Min:%9.2f sec       Avg:%9.2f sec       Max:%9.2f sec\n", min_time, avg_time, max_time);
+      printf("Runs: Avg:%9.2f per exec  avg run length: %lld iters", (double) sum_runs / n_execs, (sum_runs > 0) ? sum_iters / sum_runs : 0);
+      if (qi->inst->opt > 0 || qi->inst->bks > 0)
+	printf("  %s reached: %d / %d", (qi->inst->opt > 0) ? "OPT" : "BKS", nb_bks_hits, n_execs);
+      printf("\n");
+      printf("Total: wall time:%9.2f sec  user time:%9.2f sec\n",
+	     (Real_Time() - real_time_at_start) / 1000.0, (User_Time() - user_time_at_start) / 1000.0);
+      if (race_wins != NULL)
 	{
-	  if (!Read_Values(qi->sol, size))
-	    return 1;
+	  printf("Race wins:");
+	  for (i = 0; i < n_walkers; i++)
+	    printf("  #%d%s%s%s: %d", i, (get_walker_name != NULL) ? " (" : "",
+		   (get_walker_name != NULL) ? (*get_walker_name)(i) : "", (get_walker_name != NULL) ? ")" : "", race_wins[i]);
+	  printf("\n");
 	}
-      else if (exec_no == 0 || Random_Double() >= prob_reuse)
-	Random_Permut(qi->sol, size, NULL, 0);
+    }
+
+  printf("\n");
+
+  return 0;
+}
+
+
+
+/*
+ *  Seqlock of a shared solution (elite slots, best of a race)
+ *  A writer makes seq odd during its update, a reader retries (or gives up) if
+ *  seq is odd or has changed during its copy. The protected data are only
+ *  accessed with relaxed atomics (else a concurrent read is a data race) and
+ *  the fences order them w.r.t. seq, also on weakly ordered cpus.
+ */
+static int
+Seq_Write_Begin(unsigned *p_seq, unsigned *seq)	/* returns 0 if another thread is writing */
+{
+  unsigned s = __atomic_load_n(p_seq, __ATOMIC_RELAXED);
+
+  if ((s & 1) || !__atomic_compare_exchange_n(p_seq, &s, s + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    return 0;
+
+  __atomic_thread_fence(__ATOMIC_RELEASE); /* the data are not written before seq is odd */
+  *seq = s;
+  return 1;
+}
+
+
+static void
+Seq_Write_End(unsigned *p_seq, unsigned seq)
+{
+  __atomic_store_n(p_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+
+static unsigned
+Seq_Read_Begin(unsigned *p_seq)
+{
+  return __atomic_load_n(p_seq, __ATOMIC_ACQUIRE);
+}
+
+
+static int
+Seq_Read_End(unsigned *p_seq, unsigned seq)	/* returns 1 if the data read are consistent */
+{
+  __atomic_thread_fence(__ATOMIC_ACQUIRE); /* the data are read before seq is checked */
+  return !(seq & 1) && __atomic_load_n(p_seq, __ATOMIC_RELAXED) == seq;
+}
+
+
+static void
+Seq_Copy_Vector(QAPVector dst, QAPVector src, int size)
+{
+  int i;
+
+  for (i = 0; i < size; i++)
+    __atomic_store_n(&dst[i], __atomic_load_n(&src[i], __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+
+/*
+ *  Empties an elite pool (no other thread must use it)
+ */
+static void
+Elite_Reset(ElitePool *pool)
+{
+  int i;
+
+  for (i = 0; i < pool->nb_slots; i++)
+    {
+      pool->slot[i].seq = 0;
+      pool->slot[i].cost = QAP_COST_MAX;
+    }
+}
+
+
+/*
+ *  Allocates an empty elite pool of nb_slots solutions of size elements
+ */
+static ElitePool *
+Elite_Alloc(int nb_slots, int size)
+{
+  ElitePool *pool = Malloc(sizeof(ElitePool));
+  int i;
+
+  pool->nb_slots = nb_slots;
+  pool->slot = Malloc(nb_slots * sizeof(EliteSlot));
+  for (i = 0; i < nb_slots; i++)
+    pool->slot[i].sol = QAP_Alloc_Vector(size);
+  Elite_Reset(pool);
+
+  return pool;
+}
+
+
+/*
+ *  Offers a solution to an elite pool (lock-free, never waits)
+ *  It replaces the worst elite if it is better and its cost is not already in the pool.
+ *  Gives up if this slot is being written by another island.
+ */
+static void
+Elite_Publish(ElitePool *pool, QAPVector sol, QAPCost cost, int size)
+{
+  EliteSlot *slot = NULL;
+  QAPCost worst_cost = cost;
+  unsigned seq;
+  int i;
+
+  for (i = 0; i < pool->nb_slots; i++)
+    {
+      QAPCost c = __atomic_load_n(&pool->slot[i].cost, __ATOMIC_RELAXED);
+
+      if (c == cost)		/* (very likely) already in the pool */
+	return;
+      if (c > worst_cost)
+	{
+	  worst_cost = c;
+	  slot = &pool->slot[i];
+	}
+    }
+
+  if (slot == NULL)
+    return;
+
+  if (!Seq_Write_Begin(&slot->seq, &seq))
+    return;
+
+  if (__atomic_load_n(&slot->cost, __ATOMIC_RELAXED) > cost) /* still worse (it may have changed before we locked it) */
+    {
+      Seq_Copy_Vector(slot->sol, sol, size);
+      __atomic_store_n(&slot->cost, cost, __ATOMIC_RELAXED);
+    }
+  Seq_Write_End(&slot->seq, seq);
+}
+
+
+/*
+ *  Copies a random elite of the pool into sol (lock-free)
+ *  Returns its cost (QAP_COST_MAX if the pool is empty)
+ */
+static QAPCost
+Elite_Pick(ElitePool *pool, QAPVector sol, int size)
+{
+  int start = Random(pool->nb_slots);
+  int k;
+
+  for (k = 0; k < pool->nb_slots; k++)
+    {
+      EliteSlot *slot = &pool->slot[(start + k) % pool->nb_slots];
+      unsigned seq = Seq_Read_Begin(&slot->seq);
+      QAPCost cost = __atomic_load_n(&slot->cost, __ATOMIC_RELAXED);
+
+      if ((seq & 1) || cost == QAP_COST_MAX)
+	continue;
+
+      Seq_Copy_Vector(sol, slot->sol, size);
+      if (Seq_Read_End(&slot->seq, seq)) /* not modified during the copy */
+	return cost;
+    }
+
+  return QAP_COST_MAX;
+}
+
+
+/*
+ *  Sends the run best of the island to the elite pool (if improved since the last migration)
+ */
+static void
+Island_Migrate(void)
+{
+  next_migration = report_state.exec_iters + migration_iters;
+  if (report_state.run_best_cost < migrated_cost)
+    {
+      Elite_Publish(elite_pool, run_best_sol, report_state.run_best_cost, qi->inst->size);
+      migrated_cost = report_state.run_best_cost;
+    }
+}
+
+
+/*
+ *  Changes qi->sol into sol keeping delta and cost up to date
+ *  If sol is close to qi->sol (as often the exec best or an elite) it is done with
+ *  QAP_Do_Swap: O(n^2) per swap (at most 1 per position differing) instead of the O(n^3)
+ *  of QAP_Set_Solution. Otherwise sol is copied and sol_is_set is reset.
+ */
+static void
+Move_To_Solution(QAPVector sol)
+{
+  int size = qi->inst->size;
+  QAPVector pos = restart_pos;
+  int i, j, nb_diff = 0;
+
+  for (i = 0; i < size; i++)
+    nb_diff += (qi->sol[i] != sol[i]);
+
+  if (!sol_is_set || nb_diff > size / 2)
+    {
+      if (sol != qi->sol)
+	QAP_Copy_Vector(qi->sol, sol, size);
+      sol_is_set = 0;
+      return;
+    }
+
+  for (i = 0; i < size; i++)
+    pos[qi->sol[i]] = i;
+
+  for (i = 0; i < size; i++)
+    if (qi->sol[i] != sol[i])
+      {
+	j = pos[sol[i]];
+	pos[qi->sol[i]] = j;
+	pos[sol[i]] = i;
+	QAP_Do_Swap(qi, i, j);
+      }
+}
+
+
+/*
+ *  Perturbs qi->sol with nb_swaps random swaps (at least 2)
+ *  If sol_is_set they are done with QAP_Do_Swap: O(nb_swaps * n^2) instead of O(n^3).
+ */
+static void
+Perturb_Solution(int nb_swaps)
+{
+  int size = qi->inst->size;
+  QAPVector sol = qi->sol;
+  int k;
+
+  if (nb_swaps < 2)
+    nb_swaps = 2;
+
+  for (k = 0; k < nb_swaps; k++)
+    {
+      int i = Random(size);
+      int j = Random(size - 1);
+
+      if (j >= i)
+	j++;
+
+      if (sol_is_set)
+	QAP_Do_Swap(qi, i, j);
       else
-	reuse = 1;
+	{
+	  int x = sol[i];
 
-      if (n_execs > 1)
-	printf("exec #%d %s\n", exec_no + 1, (reuse) ? "(reuse previous configuration)" : "");
-#endif
-      exec_best_cost = INT_MAX;
-      exec_iters = 0;
+	  sol[i] = sol[j];
+	  sol[j] = x;
+	}
+    }
+}
 
-      Init_Elapsed_Time();
-      signal(SIGINT, Ctrl_C_Handler);
-      for(run_no = 0; !Is_Interrupted() && exec_best_cost > target_cost && exec_iters < max_exec_iters; run_no++)
+
+/*
+ *  Returns the #iterations of the run #run_no according to the restart policy
+ *  (RESTART_RATE: not bounded, see Report_Solution)
+ */
+static int
+Restart_Max_Iters(int run_no)
+{
+  double n = restart_limit.iters;
+  int i, k;
+
+  switch (restart_policy)
+    {
+    case RESTART_LUBY:		/* luby(i) = 2^(k-1) if i = 2^k - 1, else luby(i - 2^(k-1) + 1) with 2^(k-1) <= i < 2^k - 1 */
+      for (i = run_no + 1; ; i -= (1 << (k - 1)) - 1)
+	{
+	  for (k = 1; (1 << k) - 1 < i; k++)
+	    ;
+	  if (i == (1 << k) - 1)
+	    break;
+	}
+      n *= 1 << (k - 1);
+      break;
+
+    case RESTART_GEOM:
+      n *= pow(restart_param, run_no);
+      break;
+
+    case RESTART_RATE:
+      return INT_MAX;
+    }
+
+  return (n < INT_MAX) ? (int) n : INT_MAX;
+}
+
+
+/*
+ *  Executes the runs of an exec (first + restarts) from qi->sol
+ *  A restart is made from a random solution, or from the current or best one perturbed
+ *  by -k swaps. Islands (-E) restart from a perturbed elite of their pool (if not empty).
+ *  The O(n^3) QAP_Set_Solution is only done if needed (see sol_is_set).
+ */
+static void
+Do_Runs(void)
+{
+  int size = qi->inst->size;
+
+  if (restart_sol == NULL)
+    {
+      restart_sol = QAP_Alloc_Vector(size);
+      restart_pos = QAP_Alloc_Vector(size);
+    }
+
+  exec_best_cost = QAP_COST_MAX;
+  report_state.exec_iters = 0;
+  perturb_k = perturb_swaps;
+
+  exec_deadline = (exec_limit.secs > 0) ? Limit_Time() + (long) (exec_limit.secs * 1000) : LONG_MAX;
+  time_out = 0;
+
+  for(run_no = 0; !Is_Interrupted() && exec_best_cost > target_cost && report_state.exec_iters < exec_max_iters && time_out < 2; run_no++)
+    {
+      if (run_no > 0)
 	{
-	  if (run_no > 0)
+	  QAPCost elite_cost = QAP_COST_MAX;
+
+	  if (elite_pool != NULL && (elite_cost = Elite_Pick(elite_pool, restart_sol, size)) < QAP_COST_MAX)
+	    {
+	      Move_To_Solution(restart_sol);
+	      Perturb_Solution((perturb_swaps > 0) ? perturb_k : (int) (size * ELITE_PERTURB_RATIO));
+	    }
+	  else if (perturb_swaps > 0)
+	    {
+	      if (perturb_best)	/* in a race: the best of all the walkers */
+		Move_To_Solution((race != NULL && Race_Get_Best(restart_sol, size) < QAP_COST_MAX) ? restart_sol : exec_best_sol);
+	      Perturb_Solution(perturb_k);
+	    }
+	  else
 	    {
-	      if (verbose > 0)
-		printf("\nRestart #%d\n", run_no);
 	      Random_Permut(qi->sol, size, NULL, 0);
+	      sol_is_set = 0;
 	    }
-	  run_best_cost = INT_MAX;
-	  qi->iter_no = 0;
-	  QAP_Set_Solution(qi);
-	  Solve(qi);
-	  if (run_best_cost < exec_best_cost)
+
+	  if (verbose > 0)
 	    {
-	      exec_best_cost = run_best_cost;
-	      QAP_Copy_Vector(exec_best_sol, run_best_sol, size);
+	      if (elite_cost < QAP_COST_MAX)
+		printf("\nRestart #%d from a perturbed elite (cost: %lld)\n", run_no, elite_cost);
+	      else if (perturb_swaps > 0)
+		printf("\nRestart #%d from the %s solution perturbed by %d swaps\n", run_no,
+		       (perturb_best) ? "best" : "current", perturb_k);
+	      else
+		printf("\nRestart #%d\n", run_no);
 	    }
 	}
-      signal(SIGINT, SIG_DFL);
-      double run_time = Get_Elapsed_Time();
-      
-      printf("\nExec #%d   restarts: %d  cost: %s - solution:\n", exec_no + 1, run_no, Format_Cost_And_Gap(exec_best_cost, target_cost));
-      QAP_Display_Vector(exec_best_sol, size);
-      printf("Time: %.3f sec\n\n", run_time);
+      report_state.run_best_cost = QAP_COST_MAX; /* the first Report_Solution takes the slow path */
+      run_max_iters = Restart_Max_Iters(run_no);
+      run_improved_iter = 0;
+      rate_next_check = restart_limit.iters;
+      rate_check_cost = QAP_COST_MAX;
+      migrated_cost = QAP_COST_MAX;
+      run_deadline = (restart_limit.secs > 0) ? Limit_Time() + (long) (restart_limit.secs * 1000) : LONG_MAX;
+      if (run_deadline > exec_deadline)
+	run_deadline = exec_deadline;
+      time_out = 0;
+      next_migration = report_state.exec_iters + migration_iters;
+      qi->iter_no = 0;
+      if (!sol_is_set)
+	QAP_Set_Solution(qi);
+      Solve(qi);
+      sol_is_set = 1;		/* the solvers keep delta and cost up to date (QAP_Do_Swap...) */
+      if (elite_pool != NULL)
+	Island_Migrate();
+      if (report_state.run_best_cost < exec_best_cost)
+	{
+	  exec_best_cost = report_state.run_best_cost;
+	  QAP_Copy_Vector(exec_best_sol, run_best_sol, size);
+	  perturb_k = perturb_swaps;
+	}
+      else if (perturb_adapt && perturb_k < size / 2)
+	perturb_k += 1 + perturb_k / 4;
+    }
+  exec_total_iters = report_state.exec_iters;
+}
+
+
+/*
+ *  Executes the bench exec #exec_no from qi->sol (all its runs) and records its statistics
+ */
+static void
+Do_Exec(void)
+{
+  int size = qi->inst->size;
+
+  double walkers_time = 0.0;
+
+  Init_Elapsed_Time();
+  if (n_walkers > 1)
+    walkers_time = Do_Race();
+  else
+    Do_Runs();
+  double run_time = Get_Elapsed_Time() + walkers_time;
+  QAPCost bks = (qi->inst->opt > 0) ? qi->inst->opt : qi->inst->bks;
+
+  pthread_mutex_lock(&stat_mutex);
+  printf("\nExec #%d   restarts: %d  cost: %s - solution:\n", exec_no + 1, run_no, Format_Cost_And_Gap(exec_best_cost, target_cost));
+  QAP_Display_Vector(exec_best_sol, size);
+  printf("Time: %.3f sec  iters: %lld (avg run: %lld)\n\n", run_time, exec_total_iters, (run_no > 0) ? exec_total_iters / run_no : 0);
+
+  sum_cost += exec_best_cost;
+  sum_time += run_time;
+  sum_iters += exec_total_iters;
+  sum_runs += run_no;
+  if (bks > 0 && exec_best_cost <= bks)
+    nb_bks_hits++;
+
+  if (exec_best_cost > max_cost)
+    max_cost = exec_best_cost;
+
+  if (exec_best_cost < min_cost)
+    min_cost = exec_best_cost;
+
+  if (run_time > max_time)
+    max_time = run_time;
+
+  if (run_time < min_time)
+    min_time = run_time;
+  pthread_mutex_unlock(&stat_mutex);
+}
+
 
-      sum_cost += exec_best_cost;
-      sum_time += run_time;
+/*
+ *  A walker of a race (walkers #1, #2,...: walker #0 is the thread running the exec)
+ */
+static void *
+Walker_Thread(void *arg)
+{
+  Walker *w = arg;
+
+  race = w->race;
+  elite_pool = race->pool;
+  walker_no = w->walker_no;
+  qi = w->qi;
+  exec_best_sol = w->best_sol;
+  run_best_sol = w->run_best_sol;
+  restart_sol = w->restart_sol;
+  restart_pos = w->restart_pos;
+  exec_no = w->race_exec_no;
+
+  Init_Elapsed_Time();
+  Randomize_Stream(seed + exec_no, walker_no);
+  Random_Permut(qi->sol, qi->inst->size, NULL, 0);
+  sol_is_set = 0;
+  Do_Runs();
+
+  w->nb_runs = run_no;
+  w->nb_iters = exec_total_iters;
+  w->user_time = Get_Elapsed_Time();
+
+  return NULL;
+}
 
-      if (exec_best_cost > max_cost)
-	max_cost = exec_best_cost;
 
-      if (exec_best_cost < min_cost)
-	min_cost = exec_best_cost;
+/*
+ *  Races n_walkers copies of the solver (-w): the exec result is the best of the walkers.
+ *  Returns the user time of the other walkers (only needed with -j, see Exec_User_Time).
+ *  Walker #0 is the calling thread (starting from qi->sol), walker #k uses the stream #k of
+ *  the seed SEED+exec_no. The walkers share the best cost and solution (see Race_Record,
+ *  read by -B restarts) and stop as soon as one reaches the target (see Is_Interrupted).
+ *  Each walker has its own iteration budget.
+ */
+static double
+Do_Race(void)
+{
+  int size = qi->inst->size;
+  Race r = { QAP_COST_MAX, 0, QAP_COST_MAX, 0, 0, NULL, -1, 0, 0, NULL };
+  long real_time_at_start = Real_Time();
+  pthread_t *thread = Malloc(n_walkers * sizeof(pthread_t));
+  int i;
 
-      if (run_time > max_time)
-	max_time = run_time;
+  if (walker_tbl == NULL)
+    {
+      walker_tbl = Calloc(n_walkers, sizeof(Walker));
+      for (i = 1; i < n_walkers; i++)
+	{
+	  walker_tbl[i].walker_no = i;
+	  walker_tbl[i].qi = QAP_New_Info(qi->inst);
+	  walker_tbl[i].best_sol = QAP_Alloc_Vector(size);
+	  walker_tbl[i].run_best_sol = QAP_Alloc_Vector(size);
+	  walker_tbl[i].restart_sol = QAP_Alloc_Vector(size);
+	  walker_tbl[i].restart_pos = QAP_Alloc_Vector(size);
+	}
+      if (elite_size > 0)
+	elite_pool = Elite_Alloc(elite_size, size);
+      race_best_sol = QAP_Alloc_Vector(size);
+    }
 
-      if (run_time < min_time)
-	min_time = run_time;
+  if (elite_pool != NULL)
+    Elite_Reset(elite_pool);
+  r.pool = elite_pool;
+  r.best_sol = race_best_sol;
 
+  race = &r;
+  walker_no = 0;
+  for (i = 1; i < n_walkers; i++)
+    {
+      walker_tbl[i].race = &r;
+      walker_tbl[i].race_exec_no = exec_no;
+      if (pthread_create(&thread[i], NULL, Walker_Thread, &walker_tbl[i]) != 0)
+	Fatal_Error("cannot create walker thread %d\n", i);
     }
+  Randomize_Stream(seed + exec_no, 0);
 
-  n_execs = exec_no;		/* in case of CTRL_C fix the number of execs (for average) */
-  double avg_cost = sum_cost / n_execs;
-  double avg_time = sum_time / n_execs;
-  if (n_execs > 1)
+  Do_Runs();
+
+  int nb_runs = run_no;
+  long long nb_iters = exec_total_iters;
+  double user_time = 0.0;
+  int best_walker;		/* first walker having found the best cost */
+  long best_real_time;
+
+  for (i = 1; i < n_walkers; i++)
     {
-      printf("\n#execs: %d\n", n_execs);
-      printf("Cost: Min:%s  Avg:%s  Max:%s\n", 
-	     Format_Cost_And_Gap(min_cost, target_cost), 
-	     Format_Cost_And_Gap(avg_cost, target_cost), 
-	     Format_Cost_And_Gap(max_cost, target_cost));
-      printf("Time: Min:%9.2f sec       Avg:%9.2f sec       Max:%9.2f sec\n", min_time, avg_time, max_time);
+      Walker *w = &walker_tbl[i];
+
+      pthread_join(thread[i], NULL);
+      nb_runs += w->nb_runs;
+      nb_iters += w->nb_iters;
+      user_time += w->user_time;
+    }
+				/* no more writer: the best slot of the race is stable */
+  if (r.best_sol_cost < exec_best_cost)
+    {
+      exec_best_cost = r.best_sol_cost;
+      QAP_Copy_Vector(exec_best_sol, r.best_sol, size);
+    }
+  best_walker = r.best_walker;
+  best_real_time = (r.best_sol_cost < QAP_COST_MAX) ? r.best_real_time : real_time_at_start;
+  run_no = nb_runs;
+  exec_total_iters = nb_iters;
+  race = NULL;
+  Free(thread);
+
+  if (r.winner >= 0)
+    {
+      best_walker = r.winner;
+      best_real_time = r.winner_real_time;
     }
 
-  printf("\n");
+  printf("exec #%d: walker #%d%s%s%s %s first (wall time: %.3f sec)\n", exec_no + 1, best_walker,
+	 (get_walker_name != NULL) ? " (" : "", (get_walker_name != NULL) ? (*get_walker_name)(best_walker) : "",
+	 (get_walker_name != NULL) ? ")" : "", (r.winner >= 0) ? "reached the target" : "found the best cost",
+	 (best_real_time - real_time_at_start) / 1000.0);
 
-  return 0;
+  pthread_mutex_lock(&stat_mutex);
+  race_wins[best_walker]++;
+  pthread_mutex_unlock(&stat_mutex);
+
+  return (n_threads > 0) ? user_time : 0.0;
 }
 
 
+/*
+ *  An exec thread (-j): runs the next execs with its own solving vars
+ *  Exec #k uses the seed seed + k - 1 (results do not depend on the #threads).
+ *  -P reuses the configuration of the previous exec of the same thread.
+ */
+static void *
+Exec_Thread(void *arg)
+{
+  int size = qi_main->inst->size;
+  int first = 1;
+
+  qi = QAP_New_Info(qi_main->inst);
+  exec_best_sol = QAP_Alloc_Vector(size);
+  run_best_sol = QAP_Alloc_Vector(size);
+
+  while (!Is_Interrupted() && (exec_no = __atomic_fetch_add(&next_exec_no, 1, __ATOMIC_RELAXED)) < n_execs)
+    {
+      int reuse;
+
+      Randomize_Seed(seed + exec_no);
+      reuse = (Random_Double() < prob_reuse && !first); /* always draw: same sequence in any thread */
+      if (!reuse)
+	{
+	  Random_Permut(qi->sol, size, NULL, 0);
+	  sol_is_set = 0;
+	}
+      first = 0;
+
+      if (n_execs > 1)
+	printf("exec #%d (seed %d) %s\n", exec_no + 1, seed + exec_no, (reuse) ? "(reuse previous configuration)" : "");
+
+      Do_Exec();
+    }
+
+  return NULL;
+}
 
+
+
+/*
+ *  Records a new best cost (and solution) of a walker in its race (lock-free)
+ *  Returns 1 if it is a new best of the race.
+ *  The cost is lowered with a CAS, the solution slot is a seqlock: a writer only
+ *  waits for another one while its cost is still the best of the race.
+ */
+static int
+Race_Record(QAPCost cost, QAPVector sol, int size)
+{
+  QAPCost best = __atomic_load_n(&race->best_cost, __ATOMIC_RELAXED);
+  unsigned seq;
+
+  while (cost < best &&
+	 !__atomic_compare_exchange_n(&race->best_cost, &best, cost, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+
+  if (cost < best)		/* the CAS succeeded */
+    while (__atomic_load_n(&race->best_cost, __ATOMIC_RELAXED) == cost)
+      if (Seq_Write_Begin(&race->best_seq, &seq))
+	{
+	  if (__atomic_load_n(&race->best_sol_cost, __ATOMIC_RELAXED) > cost)
+	    {
+	      Seq_Copy_Vector(race->best_sol, sol, size);
+	      __atomic_store_n(&race->best_sol_cost, cost, __ATOMIC_RELAXED);
+	      __atomic_store_n(&race->best_walker, walker_no, __ATOMIC_RELAXED);
+	      __atomic_store_n(&race->best_real_time, Real_Time(), __ATOMIC_RELAXED);
+	    }
+	  Seq_Write_End(&race->best_seq, seq);
+	  break;
+	}
+
+  int none = -1;
+  if (cost <= target_cost &&
+      __atomic_compare_exchange_n(&race->winner, &none, walker_no, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+      race->winner_real_time = Real_Time();
+      __atomic_store_n(&race->stop, 1, __ATOMIC_RELEASE);
+    }
+
+  return cost < best;
+}
+
+
+/*
+ *  Copies the current best solution of the race into sol (lock-free)
+ *  Returns its cost (QAP_COST_MAX if none or if it is being written)
+ */
+static QAPCost
+Race_Get_Best(QAPVector sol, int size)
+{
+  unsigned seq = Seq_Read_Begin(&race->best_seq);
+  QAPCost cost = __atomic_load_n(&race->best_sol_cost, __ATOMIC_RELAXED);
+
+  if ((seq & 1) || cost == QAP_COST_MAX)
+    return QAP_COST_MAX;
+
+  Seq_Copy_Vector(sol, race->best_sol, size);
+  return Seq_Read_End(&race->best_seq, seq) ? cost : QAP_COST_MAX;
+}
+
+
+
+/*
+ *  Slow path of Report_Solution (see main.h), called on an improvement of the run
+ *  or when the next check is due (report_state.exec_iters is already incremented)
+ */
 int
-Report_Solution(QAPInfo qi)
+Report_Solution_Slow(QAPInfo qi)
 {
-  int size = qi->size;
-  int cost = qi->cost;
+  int size = qi->inst->size;
+  QAPCost cost = qi->cost;
   int iter_no = qi->iter_no;
-  exec_iters++;
+  long long last_iter_no;
+  int cont;
 
-  if (cost < run_best_cost)
-    {
-      run_best_cost = cost;
+  if (elite_pool != NULL && report_state.exec_iters >= next_migration)
+    Island_Migrate();
+
+  if (cost < report_state.run_best_cost)
+    {			/* improved: of the exec (of the race with -w) */
+      int improved = (race != NULL) ? Race_Record(cost, qi->sol, size) : cost < exec_best_cost;
+
+      report_state.run_best_cost = cost;
+      run_improved_iter = iter_no;
       QAP_Copy_Vector(run_best_sol, qi->sol, size);
       if (verbose > 0)
 	{
-	  printf("iter:%9d  cost: %s%s\n", iter_no, Format_Cost_And_Gap(cost, target_cost), (cost < exec_best_cost) ? " *** IMPROVED ***": "");
+	  printf("iter:%9d  cost: %s%s\n", iter_no, Format_Cost_And_Gap(cost, target_cost), (improved) ? " *** IMPROVED ***": "");
 	  if (verbose > 1)
 	    QAP_Display_Vector(run_best_sol, size);
 	}
     }
-#if 0				/* to check if incremental delta works */
-  if (cost != QAP_Cost_Of_Solution(qi))
-    printf("ERROR on cost: %d != %d at iter: %d\n", cost, QAP_Cost_Of_Solution(qi), iter_no);
-#endif
-  return !Is_Interrupted() && cost > target_cost && exec_iters <= max_exec_iters && iter_no <= max_restart_iters;
+  if ((report_state.exec_iters & (((cpu_limits) ? CPU_TIME_CHECK_ITERS : TIME_CHECK_ITERS) - 1)) == 0 &&
+      run_deadline != LONG_MAX && Limit_Time() >= run_deadline)
+    time_out = (run_deadline == exec_deadline) ? 2 : 1;
+
+  if (restart_policy == RESTART_RATE && iter_no >= rate_next_check)
+    {				/* restart if the improvement of the last ITERS iters is too small */
+      if (rate_check_cost - report_state.run_best_cost < restart_param * fabs((double) rate_check_cost))
+	return 0;
+      rate_next_check = iter_no + restart_limit.iters;
+      rate_check_cost = report_state.run_best_cost;
+    }
+
+  last_iter_no = (long long) ((restart_limit.stagnation) ? run_improved_iter : 0) + run_max_iters;
+  if (last_iter_no > RUN_MAX_ITERS)
+    last_iter_no = RUN_MAX_ITERS;
+  cont = !Is_Interrupted() && cost > target_cost && report_state.exec_iters <= exec_max_iters && !time_out &&
+    iter_no <= last_iter_no;
+
+  if (cont)			/* next slow path: next time check, migration or limit */
+    {
+      report_state.next_check = (report_state.exec_iters | (TIME_CHECK_ITERS - 1)) + 1;
+      if (report_state.next_check > exec_max_iters)
+	report_state.next_check = exec_max_iters;
+      if (elite_pool != NULL && report_state.next_check > next_migration)
+	report_state.next_check = next_migration;
+
+      if (restart_policy == RESTART_RATE && last_iter_no >= rate_next_check)
+	last_iter_no = rate_next_check - 1;
+      report_state.last_iter_no = (int) last_iter_no;
+    }
+
+  return cont;
 }
 
 
+/*
+ *  Returns the max #iterations of the current run (INT_MAX if not bounded)
+ */
 int
 Get_Run_Max_Iterations(void)
 {
-  return max_restart_iters;
+  return (restart_limit.stagnation) ? INT_MAX : run_max_iters;
 }
 
 
@@ -337,15 +1256,15 @@ Ctrl_C_Handler(int sig)
 
 
 char *
-Format_Cost_And_Gap(int cost, int target_cost)
+Format_Cost_And_Gap(QAPCost cost, QAPCost target_cost)
 {
-  static char buff[12][128];
-  static int no_buff = 0;
+  static __thread char buff[12][128];
+  static __thread int no_buff = 0;
   char *p = buff[no_buff];
   no_buff = (no_buff + 1) % 12;
   char *q = buff[no_buff];
   no_buff = (no_buff + 1) % 12;
-  int base = target_cost;
+  QAPCost base = target_cost;
   //int base = cost;
   double run_time = Get_Elapsed_Time();
 
@@ -354,7 +1273,7 @@ Format_Cost_And_Gap(int cost, int target_cost)
   else
     sprintf(q, "pd: %6.3f %%  ", 100.0 * (cost - target_cost) / base);
 
-  sprintf(p, "%9d  %stime: %9.2f sec", cost, q, run_time);
+  sprintf(p, "%9lld  %stime: %9.2f sec", cost, q, run_time);
 
   return p;
 }
@@ -364,11 +1283,51 @@ Format_Cost_And_Gap(int cost, int target_cost)
 void
 Register_Option(char *name, OptType type, char * help_arg, char *help_text, void *p_value)
 {
+  if (option_prefix != NULL)	/* -x becomes -PREFIX-x */
+    {
+      char *name1 = Malloc(strlen(option_prefix) + strlen(name) + 2);
+      sprintf(name1, "-%s-%s", option_prefix, name + 1);
+      name = name1;
+    }
+
   option[n_option] = (Option) { name, type, help_arg, help_text, p_value, 0 };
   n_option++;
 }
 
 
+/*
+ *  Sets a prefix for the next registered options (NULL: no prefix)
+ *  (e.g. to register the options of several solvers without conflict)
+ */
+void
+Set_Option_Prefix(char *prefix)
+{
+  option_prefix = prefix;
+}
+
+
+/*
+ *  Registers the default number of walkers of a race (if -w is not given)
+ *  and the name of each walker (e.g. its solver)
+ */
+void
+Register_Walkers(int (*get_nb)(void), char *(*get_name)(int walker_no))
+{
+  get_nb_walkers = get_nb;
+  get_walker_name = get_name;
+}
+
+
+/*
+ *  Returns the number of the walker of the calling thread in its race (0 if no race)
+ */
+int
+Get_Walker_Number(void)
+{
+  return walker_no;
+}
+
+
 
 #define L(...) do { fprintf(stderr,  __VA_ARGS__); fprintf(stderr, "\n"); } while(0)
 
@@ -432,6 +1391,15 @@ Parse_Cmd_Line(int argc, char *argv[])
 		}
 	      break;
 
+	    case OPT_COST:
+	      * (QAPCost *) option[k].p_value = strtoll(argv[i], &end, 10);
+	      if (*end != '\0')
+		{
+		  L("%s must be an integer - found %s %s", option[k].help_arg, argv[i - 1], argv[i]);
+		  exit(1);
+		}
+	      break;
+
 	    case OPT_DBL:
 	      * (double *) option[k].p_value = strtod(argv[i], &end);
 	      if (*end != '\0')
@@ -444,6 +1412,27 @@ Parse_Cmd_Line(int argc, char *argv[])
 	    case OPT_STR:
 	      * (char **) option[k].p_value = argv[i];
 	      break;
+
+	    case OPT_LIMIT:
+	      {
+		Limit *limit = (Limit *) option[k].p_value;
+		int plus = (*argv[i] == '+');
+		double x = strtod(argv[i] + plus, &end);
+
+		if (*end == 's' && end[1] == '\0' && x > 0 && !plus)
+		  limit->secs = x;
+		else if (*end == '\0' && x == (int) x)
+		  {
+		    limit->iters = (int) x;
+		    limit->stagnation = plus;
+		  }
+		else
+		  {
+		    L("%s must be an integer, +integer or a time XXXs - found %s %s", option[k].help_arg, argv[i - 1], argv[i]);
+		    exit(1);
+		  }
+	      }
+	      break;
 	    }
 	}
       else if (file_name == NULL)
@@ -465,6 +1454,47 @@ Parse_Cmd_Line(int argc, char *argv[])
 }
 
 
+
+/*
+ *  Parses the restart policy (-L POLICY[:PARAM])
+ */
+static void
+Parse_Restart_Policy(void)
+{
+  int len = strcspn(restart_policy_spec, ":");
+  char *end;
+  int k;
+
+  for (k = RESTART_FIXED; k <= RESTART_RATE; k++)
+    if (strlen(restart_policy_name[k]) == (size_t) len && strncmp(restart_policy_spec, restart_policy_name[k], len) == 0)
+      break;
+
+  if (k > RESTART_RATE)
+    {
+      fprintf(stderr, "unknown restart policy %s (-h for a help)\n", restart_policy_spec);
+      exit(1);
+    }
+
+  restart_policy = k;
+  restart_param = (k == RESTART_GEOM) ? 1.5 : (k == RESTART_RATE) ? 0.001 : 0;
+  if (restart_policy_spec[len] == ':')
+    {
+      restart_param = strtod(restart_policy_spec + len + 1, &end);
+      if (*end != '\0' || restart_param <= 0 || (k != RESTART_GEOM && k != RESTART_RATE))
+	{
+	  fprintf(stderr, "bad parameter in restart policy %s (-h for a help)\n", restart_policy_spec);
+	  exit(1);
+	}
+    }
+
+  if (k != RESTART_FIXED && restart_limit.iters == INT_MAX)
+    {
+      fprintf(stderr, "restart policy %s needs -r ITERS\n", restart_policy_name[k]);
+      exit(1);
+    }
+}
+
+
 int 
 Get_Verbose_Level(void)
 {
@@ -474,5 +1504,5 @@ Get_Verbose_Level(void)
 int 
 Is_Interrupted(void)
 {
-  return ctrl_c;
+  return ctrl_c || (race != NULL && __atomic_load_n(&race->stop, __ATOMIC_RELAXED));
 }
@@ -17,11 +17,21 @@ typedef enum
 {
   OPT_NON, 
   OPT_INT, 
+  OPT_COST,			/* a QAPCost (long long) */
   OPT_DBL, 
-  OPT_STR
+  OPT_STR,
+  OPT_LIMIT			/* a Limit: ITERS, +ITERS or SECSs (e.g. 1000, +500 or 2.5s) */
 }OptType;
 
 
+typedef struct
+{
+  int iters;			/* max #iterations (INT_MAX: none) */
+  double secs;			/* max time in seconds (0: none) */
+  int stagnation;		/* iters counted from the last improvement ? (+ITERS) */
+}Limit;
+
+
 #ifdef _MAIN_C
 #define DEF_IN_MAIN(decl, init) decl = init;
 #else
@@ -32,15 +42,49 @@ typedef enum
 
 void Register_Option(char *name, OptType type, char *help_arg, char *help_text, void *p_value);
 
+void Set_Option_Prefix(char *prefix);
+
+void Register_Walkers(int (*get_nb)(void), char *(*get_name)(int walker_no));
+
+int Get_Walker_Number(void);
+
 int Get_Verbose_Level(void);
 
 #define VERB(level, ...) do { if (Get_Verbose_Level() >= level) { printf(__VA_ARGS__); printf("\n"); } } while(0)
 
-int Report_Solution(QAPInfo qi);
+typedef struct			/* per-thread state read by the inlined Report_Solution */
+{
+  long long exec_iters;		/* total #iters in one bench exec (can exceed INT_MAX with a time limit) */
+  QAPCost run_best_cost;	/* inside 1 bench exec and 1 run */
+  long long next_check;		/* exec_iters of the next slow path (time limits, migration, -m...) */
+  int last_iter_no;		/* iter_no above which the slow path ends the run (-r, -L) */
+}ReportState;
+
+DEF_IN_MAIN(__thread ReportState report_state, { 0 })
+
+int Report_Solution_Slow(QAPInfo qi);
+
+/*
+ *  Records an iteration of the solver, returns 0 to stop the run.
+ *  Most iterations neither improve the run nor reach a check: they stay inlined.
+ */
+static inline int
+Report_Solution(QAPInfo qi)
+{
+#if 0				/* to check if incremental delta works */
+  if (qi->cost != QAP_Cost_Of_Solution(qi))
+    printf("ERROR on cost: %lld != %lld at iter: %d\n", qi->cost, QAP_Cost_Of_Solution(qi), qi->iter_no);
+#endif
+  if (++report_state.exec_iters < report_state.next_check && qi->cost >= report_state.run_best_cost &&
+      qi->iter_no <= report_state.last_iter_no)
+    return 1;
+
+  return Report_Solution_Slow(qi);
+}
 
 int Is_Interrupted(void);
 
-char *Format_Cost_And_Gap(int cost, int target_cost);
+char *Format_Cost_And_Gap(QAPCost cost, QAPCost target_cost);
 
 int Read_Values(QAPVector sol, int size);
 
@@ -48,9 +92,18 @@ int Get_Run_Max_Iterations(void);
 
 		/* these functions must be provided by the user code */
 
+#ifdef SOLVER_PREFIX		/* solver compiled for qap-portfolio: PREFIX_Solve... (see portfolio.c) */
+#define SOLVER_FCT(f)       SOLVER_FCT1(SOLVER_PREFIX, f)
+#define SOLVER_FCT1(p, f)   SOLVER_FCT2(p, f)
+#define SOLVER_FCT2(p, f)   p ## _ ## f
+#define Init_Main           SOLVER_FCT(Init_Main)
+#define Display_Parameters  SOLVER_FCT(Display_Parameters)
+#define Solve               SOLVER_FCT(Solve)
+#endif
+
 void Init_Main(void);
 
-void Display_Parameters(QAPInfo qi, int target_cost);
+void Display_Parameters(QAPInfo qi, QAPCost target_cost);
 
 void Solve(QAPInfo qi);
 
@@ -45,17 +45,17 @@ main(int argc, char *argv[])
   file_name = (sz == 8) ? "grey8_8-base.dat" : "grey16_16-base.dat";
 
   qi = QAP_Load_Problem(file_name, 0);
-  n = qi->size;
+  n = qi->inst->size;
 
   int max = 0;
 
   for (i = 0; i < n; i++)
     for(j = 0; j < n; j++)
       {
-	qi->a[i][j] = (i < m && j < m) ? 1 : 0;
+	QAP_Elem(qi->inst->a, i, j) = (i < m && j < m) ? 1 : 0;
 
-        if (qi->b[i][j] > max)
-          max = qi->b[i][j];
+        if (QAP_Elem(qi->inst->b, i, j) > max)
+          max = QAP_Elem(qi->inst->b, i, j);
       }
 
   int nb10 = 0;
@@ -68,18 +68,18 @@ main(int argc, char *argv[])
     }
 
 
-  /*  qi->opt = 0;
-      qi->bound = 0;
+  /*  qi->inst->opt = 0;
+      qi->inst->bound = 0;
   */
-  qi->bks = (sz == 8) ? bks8[m] : bks16[m];
+  qi->inst->bks = (sz == 8) ? bks8[m] : bks16[m];
 
-  printf("%d %d %d\n", qi->size, qi->opt, qi->bks);
+  printf("%d %lld %lld\n", qi->inst->size, qi->inst->opt, qi->inst->bks);
   for(i = 0; i < n; i++)
     {
       int c = '\n';
       for (j = 0; j < n; j++)
         {
-          printf("%c%d", c, qi->a[i][j]);
+          printf("%c%d", c, QAP_Elem(qi->inst->a, i, j));
           c = ' ';
         }
     }
@@ -90,7 +90,7 @@ main(int argc, char *argv[])
       int c = '\n';
       for (j = 0; j < n; j++)
         {
-          printf("%c%*d", c, nb10, qi->b[i][j]);
+          printf("%c%*d", c, nb10, QAP_Elem(qi->inst->b, i, j));
           c = ' ';
         }
     }
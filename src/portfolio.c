@@ -0,0 +1,197 @@
+/*
+ *  Quadratic Assignment Problem
+ *
+ *  Copyright (C) 2015-2022 Daniel Diaz
+ *
+ *  portfolio.c: solve QAP with a portfolio of solvers racing in each execution
+ */
+
+
+/*
+ *  compile with: make qap-portfolio
+ *
+ *  execute with: ./qap-portfolio Data/tai40a.qap -m 1000000
+ *  or with     : ./qap-portfolio Data/tai40a.qap -M eo,rots,rots,sa -m 1000000 -b 10
+ *
+ *  Each solver of the mix is a walker of the race of an execution (see -w in main.c):
+ *  walker #k runs solver k % #mix on its own copy of the solving vars (A and B are shared).
+ *  The options of a solver are prefixed by its name (e.g. -eo-t TAU, -rots-t TABU_DURATION).
+ *  NB: -m counts the iterations of each solver (an iteration of eo is not an iteration of sa).
+ *
+ *  The execution can be interrupted with CTRL+C
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tools.h"
+#include "main.h"
+#include "qap-utils.h"
+
+
+#define DECLARE_SOLVER(prefix)						\
+  void prefix ## _Init_Main(void);					\
+  void prefix ## _Display_Parameters(QAPInfo qi, QAPCost target_cost);	\
+  void prefix ## _Solve(QAPInfo qi)
+
+DECLARE_SOLVER(eo);
+DECLARE_SOLVER(rots);
+DECLARE_SOLVER(sa);
+DECLARE_SOLVER(fant);
+
+
+typedef struct
+{
+  char *name;
+  void (*init_main)(void);
+  void (*display_parameters)(QAPInfo qi, QAPCost target_cost);
+  void (*solve)(QAPInfo qi);	/* reentrant: called by each walker thread */
+} QAPSolver;
+
+#define SOLVER(prefix)  { #prefix, prefix ## _Init_Main, prefix ## _Display_Parameters, prefix ## _Solve }
+
+static QAPSolver solver_tbl[] =
+{
+  SOLVER(eo),
+  SOLVER(rots),
+  SOLVER(sa),
+  SOLVER(fant),
+};
+
+#define NB_SOLVERS  ((int) (sizeof(solver_tbl) / sizeof(solver_tbl[0])))
+
+#define MAX_MIX  64
+
+static char *mix_spec = "eo,rots,sa,fant";
+static QAPSolver *mix[MAX_MIX];	/* solver of each walker (modulo nb_mix) */
+static int nb_mix = 0;
+
+
+
+
+/*
+ *  Parses the mix of solvers (-M) once
+ */
+static void
+Parse_Mix(void)
+{
+  char buff[1024];
+  char *p;
+  int i;
+
+  if (nb_mix > 0)
+    return;
+
+  snprintf(buff, sizeof(buff), "%s", mix_spec);
+  for (p = strtok(buff, ","); p != NULL; p = strtok(NULL, ","))
+    {
+      for (i = 0; i < NB_SOLVERS && strcmp(solver_tbl[i].name, p) != 0; i++)
+	;
+
+      if (i == NB_SOLVERS)
+	{
+	  fprintf(stderr, "unknown solver %s (-h for a help)\n", p);
+	  exit(1);
+	}
+      if (nb_mix == MAX_MIX)
+	{
+	  fprintf(stderr, "too many solvers in the mix (max %d)\n", MAX_MIX);
+	  exit(1);
+	}
+      mix[nb_mix++] = &solver_tbl[i];
+    }
+
+  if (nb_mix == 0)
+    {
+      fprintf(stderr, "empty mix of solvers (-h for a help)\n");
+      exit(1);
+    }
+}
+
+
+/*
+ *  Returns the default #walkers: one per solver of the mix
+ */
+static int
+Get_Nb_Walkers(void)
+{
+  Parse_Mix();
+  return nb_mix;
+}
+
+
+/*
+ *  Returns the name of the solver run by a walker
+ */
+static char *
+Get_Walker_Name(int walker_no)
+{
+  Parse_Mix();
+  return mix[walker_no % nb_mix]->name;
+}
+
+
+
+
+/*
+ *  Defines accepted options (the options of each solver are prefixed by its name)
+ */
+void
+Init_Main(void)
+{
+  static char buff[1024];
+  int i;
+
+  strcpy(buff, "run the mix SOLVERS (comma separated) among:");
+  for (i = 0; i < NB_SOLVERS; i++)
+    sprintf(buff + strlen(buff), " %s", solver_tbl[i].name);
+  sprintf(buff + strlen(buff), " (default %s)", mix_spec);
+
+  Register_Option("-M", OPT_STR, "SOLVERS", buff, &mix_spec);
+
+  for (i = 0; i < NB_SOLVERS; i++)
+    {
+      Set_Option_Prefix(solver_tbl[i].name);
+      (*solver_tbl[i].init_main)();
+    }
+  Set_Option_Prefix(NULL);
+
+  Register_Walkers(Get_Nb_Walkers, Get_Walker_Name);
+}
+
+
+
+/*
+ *  Displays parameters (of each solver of the mix)
+ */
+void
+Display_Parameters(QAPInfo qi, QAPCost target_cost)
+{
+  int i, j;
+
+  Parse_Mix();
+  printf("solver mix    :");
+  for (i = 0; i < nb_mix; i++)
+    printf(" %s", mix[i]->name);
+  printf("\n");
+
+  for (i = 0; i < NB_SOLVERS; i++)
+    {
+      for (j = 0; j < nb_mix && mix[j] != &solver_tbl[i]; j++)
+	;
+      if (j < nb_mix)
+	(*solver_tbl[i].display_parameters)(qi, target_cost);
+    }
+}
+
+
+
+/*
+ *  General solving procedure: runs the solver of the calling walker
+ */
+void
+Solve(QAPInfo qi)
+{
+  (*mix[Get_Walker_Number() % nb_mix]->solve)(qi);
+}
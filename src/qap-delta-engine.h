@@ -0,0 +1,1035 @@
+/*
+ *  Quadratic Assignment Problem
+ *
+ *  Copyright (C) 2015-2022 Daniel Diaz
+ *
+ *  qap-delta-engine.h: cost and delta engine for one matrix width
+ *
+ *  This file is included by qap-utils.c once per element type of the
+ *  kernel matrices (ka, kb, at, bt, pb, pbt) with the following macros:
+ *
+ *    ELEM       the element type (unsigned char, short or int)
+ *    DATA       the QAPMatrix member giving the data (data8, data16 or data)
+ *    COST       the type of costs and deltas (int or long long)
+ *    DELTA_DATA the QAPTriMatrix member giving the delta data (data or data64)
+ *    DOT_DIFF   the DeltaKernel member giving the dot product
+ *               (undefined: always the scalar loop)
+ *    UPDATE_ROW_GEN, UPDATE_ROW_SYM (and their types UPDATE_ROW_GEN_T, UPDATE_ROW_SYM_T)
+ *               the DeltaKernel members updating a row of delta
+ *    FCT(f)     the name of function f for this width
+ *
+ *  The elements are promoted to int, the products are done on COST.
+ *  The functions are those described in qap-utils.c (see the comments there).
+ */
+
+#define MAT(mat)          ((ELEM *) (mat)->DATA)
+
+
+
+/*
+ *  Computes a permuted matrix pb[i][j] = b[sol[i]][sol[j]]
+ *  (used for the permuted distance matrix and its transpose)
+ */
+static void
+FCT(Compute_Permuted_Matrix)(QAPMatrix mat_PB, QAPMatrix mat_B, QAPVector sol)
+{
+  int size = mat_B->size;
+  ELEM *b = MAT(mat_B);
+  int sb = mat_B->stride;
+  ELEM *pb = MAT(mat_PB);
+  int spb = mat_PB->stride;
+  int i, j;
+
+  for (i = 0; i < size; i++)
+    {
+      ELEM *b_pi = b + (size_t) sol[i] * sb;
+      ELEM *pb_i = pb + (size_t) i * spb;
+
+      for (j = 0; j < size; j++)
+	pb_i[j] = b_pi[sol[j]];
+    }
+}
+
+
+/*
+ *  Maintains a permuted matrix after a swap of r and s
+ *  (exchanges rows r and s then columns r and s)
+ */
+static void
+FCT(Swap_Permuted_Matrix)(QAPMatrix mat_PB, int r, int s)
+{
+  int size = mat_PB->size;
+  ELEM *pb = MAT(mat_PB);
+  int spb = mat_PB->stride;
+  ELEM *pb_r = pb + (size_t) r * spb, *pb_s = pb + (size_t) s * spb;
+  ELEM x;
+  int k;
+
+  for (k = 0; k < size; k++)
+    {
+      x = pb_r[k];
+      pb_r[k] = pb_s[k];
+      pb_s[k] = x;
+    }
+
+  for (k = 0; k < size; k++)
+    {
+      ELEM *pb_k = pb + (size_t) k * spb;
+
+      x = pb_k[r];
+      pb_k[r] = pb_k[s];
+      pb_k[s] = x;
+    }
+}
+
+
+/*
+ *  Computes the cost of a solution
+ */
+static QAPCost
+FCT(Cost_Of_Solution)(QAPInfo qi)
+{
+  int size = qi->inst->size;
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *b = MAT(qi->inst->kb);
+  int sb = qi->inst->kb->stride;
+  QAPVector sol = qi->sol;
+  int i, j;
+  COST cost = 0;
+
+  if (qi->inst->a_csr != NULL)
+    {
+      QAPSparseMatrix csr = qi->inst->a_csr;
+      int e;
+
+      for (i = 0; i < size; i++)
+	{
+	  ELEM *b_pi = b + (size_t) sol[i] * sb;
+
+	  for (e = csr->row_start[i]; e < csr->row_start[i + 1]; e++)
+	    cost += (COST) csr->val[e] * b_pi[sol[csr->col[e]]];
+	}
+
+      return cost;
+    }
+
+  if (qi->pb != NULL)
+    {
+      ELEM *pb = MAT(qi->pb);
+      int spb = qi->pb->stride;
+
+      for (i = 0; i < size; i++)
+	{
+	  ELEM *a_i = a + (size_t) i * sa;
+	  ELEM *pb_i = pb + (size_t) i * spb;
+
+	  for (j = 0; j < size; j++)
+	    cost += (COST) a_i[j] * pb_i[j];
+	}
+
+      return cost;
+    }
+
+  if (qi->inst->symmetric)
+    {
+      for (i = 0; i < size; i++)
+	{
+	  ELEM *a_i = a + (size_t) i * sa;
+	  ELEM *b_pi = b + (size_t) sol[i] * sb;
+
+	  for (j = i + 1; j < size; j++)
+	    cost += (COST) a_i[j] * b_pi[sol[j]];
+	}
+      cost *= 2;
+      if (!qi->inst->zero_diag)
+	for (i = 0; i < size; i++)
+	  cost += (COST) a[(size_t) i * sa + i] * b[(size_t) sol[i] * sb + sol[i]];
+
+      return cost;
+    }
+
+  for (i = 0; i < size; i++)
+    {
+      ELEM *a_i = a + (size_t) i * sa;
+      ELEM *b_pi = b + (size_t) sol[i] * sb;
+
+      for (j = 0; j < size; j++)
+	cost += (COST) a_i[j] * b_pi[sol[j]];
+    }
+
+  return cost;
+}
+
+
+/*
+ *  Sum of (x1[k] - x2[k]) * (y1[k] - y2[k]) (by the kernel if it has one for this width)
+ */
+static inline COST
+FCT(Dot_Diff)(const ELEM *x1, const ELEM *x2, const ELEM *y1, const ELEM *y2, int n)
+{
+  COST d = 0;
+  int k;
+
+#ifdef DOT_DIFF
+  if (kernel->DOT_DIFF != NULL)
+    return (*kernel->DOT_DIFF)(x1, x2, y1, y2, n);
+#endif
+
+  for (k = 0; k < n; k++)
+    d += ((COST) x1[k] - x2[k]) * ((COST) y1[k] - y2[k]);
+
+  return d;
+}
+
+
+/*
+ *  Computes the cost difference if elements i and j are permuted
+ *  (general case)
+ */
+static inline COST
+FCT(Compute_Delta_Gen)(QAPInfo qi, int i, int j)
+{
+  int size = qi->inst->size;
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *b = MAT(qi->inst->kb);
+  int sb = qi->inst->kb->stride;
+  QAPVector sol = qi->sol;
+  int pi = sol[i];
+  int pj = sol[j];
+  ELEM *a_i = a + (size_t) i * sa, *a_j = a + (size_t) j * sa;
+  ELEM *b_pi = b + (size_t) pi * sb, *b_pj = b + (size_t) pj * sb;
+  int k, pk;
+  COST d = ((COST) a_i[i] - a_j[j]) * ((COST) b_pj[pj] - b_pi[pi]) +
+          ((COST) a_i[j] - a_j[i]) * ((COST) b_pj[pi] - b_pi[pj]);
+
+  for (k = 0; k < size; k++)
+    {
+      if (k != i && k != j)
+	{
+	  ELEM *a_k = a + (size_t) k * sa;
+	  ELEM *b_pk;
+
+	  pk = sol[k];
+	  b_pk = b + (size_t) pk * sb;
+	  d += ((COST) a_k[i] - a_k[j]) * ((COST) b_pk[pj] - b_pk[pi]) +
+	       ((COST) a_i[k] - a_j[k]) * ((COST) b_pj[pk] - b_pi[pk]);
+	}
+    }
+
+  return d;
+}
+
+
+/*
+ *  Computes the cost difference if elements i and j are permuted
+ *  (symmetric case)
+ *
+ *  The loop runs over all k (no test) and the terms k = i and k = j are removed after.
+ */
+static inline COST
+FCT(Compute_Delta_Sym)(QAPInfo qi, int i, int j)
+{
+  int size = qi->inst->size;
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *b = MAT(qi->inst->kb);
+  int sb = qi->inst->kb->stride;
+  QAPVector sol = qi->sol;
+  int pi = sol[i];
+  int pj = sol[j];
+  ELEM *a_i = a + (size_t) i * sa, *a_j = a + (size_t) j * sa;
+  ELEM *b_pi = b + (size_t) pi * sb, *b_pj = b + (size_t) pj * sb;
+  int k, pk;
+  COST d = 0;
+
+  for (k = 0; k < size; k++)
+    {
+      pk = sol[k];
+      d += ((COST) a_i[k] - a_j[k]) * ((COST) b_pj[pk] - b_pi[pk]);
+    }
+
+  d -= ((COST) a_i[i] - a_j[i]) * ((COST) b_pj[pi] - b_pi[pi]) +
+       ((COST) a_i[j] - a_j[j]) * ((COST) b_pj[pj] - b_pi[pj]);
+  d *= 2;
+
+  if (!qi->inst->zero_diag)
+    d += ((COST) a_i[i] - a_j[j]) * ((COST) b_pj[pj] - b_pi[pi]);
+
+  return d;
+}
+
+
+/*
+ *  As Compute_Delta_Gen using the permuted distance matrix
+ *  (pb[k][j] replaces b[sol[k]][sol[j]])
+ */
+static inline COST
+FCT(Compute_Delta_Gen_PB)(QAPInfo qi, int i, int j)
+{
+  int size = qi->inst->size;
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *pb = MAT(qi->pb);
+  int spb = qi->pb->stride;
+  ELEM *a_i = a + (size_t) i * sa, *a_j = a + (size_t) j * sa;
+  ELEM *pb_i = pb + (size_t) i * spb, *pb_j = pb + (size_t) j * spb;
+  int k;
+  COST d = ((COST) a_i[i] - a_j[j]) * ((COST) pb_j[j] - pb_i[i]) +
+          ((COST) a_i[j] - a_j[i]) * ((COST) pb_j[i] - pb_i[j]);
+
+  for (k = 0; k < size; k++)
+    {
+      if (k != i && k != j)
+	{
+	  ELEM *a_k = a + (size_t) k * sa;
+	  ELEM *pb_k = pb + (size_t) k * spb;
+
+	  d += ((COST) a_k[i] - a_k[j]) * ((COST) pb_k[j] - pb_k[i]) +
+	       ((COST) a_i[k] - a_j[k]) * ((COST) pb_j[k] - pb_i[k]);
+	}
+    }
+
+  return d;
+}
+
+
+/*
+ *  As Compute_Delta_Sym using the permuted distance matrix
+ *  (all rows are contiguous: the sum is done by the kernel)
+ */
+static inline COST
+FCT(Compute_Delta_Sym_PB)(QAPInfo qi, int i, int j)
+{
+  int size = qi->inst->size;
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *pb = MAT(qi->pb);
+  int spb = qi->pb->stride;
+  ELEM *a_i = a + (size_t) i * sa, *a_j = a + (size_t) j * sa;
+  ELEM *pb_i = pb + (size_t) i * spb, *pb_j = pb + (size_t) j * spb;
+  COST d = FCT(Dot_Diff)(a_i, a_j, pb_j, pb_i, size);
+
+  d -= ((COST) a_i[i] - a_j[i]) * ((COST) pb_j[i] - pb_i[i]) +
+       ((COST) a_i[j] - a_j[j]) * ((COST) pb_j[j] - pb_i[j]);
+  d *= 2;
+
+  if (!qi->inst->zero_diag)
+    d += ((COST) a_i[i] - a_j[j]) * ((COST) pb_j[j] - pb_i[i]);
+
+  return d;
+}
+
+
+/*
+ *  As Compute_Delta_Gen using the transposed matrices
+ *  (at[i][k] replaces a[k][i] and bt[pj][pk] replaces b[pk][pj]: only rows are read)
+ *
+ *  The loop runs over all k (no test) and the terms k = i and k = j are removed after.
+ */
+static inline COST
+FCT(Compute_Delta_Gen_T)(QAPInfo qi, int i, int j)
+{
+  int size = qi->inst->size;
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *b = MAT(qi->inst->kb);
+  int sb = qi->inst->kb->stride;
+  ELEM *at = MAT(qi->inst->at);
+  int sat = qi->inst->at->stride;
+  ELEM *bt = MAT(qi->inst->bt);
+  int sbt = qi->inst->bt->stride;
+  QAPVector sol = qi->sol;
+  int pi = sol[i];
+  int pj = sol[j];
+  ELEM *a_i = a + (size_t) i * sa, *a_j = a + (size_t) j * sa;
+  ELEM *b_pi = b + (size_t) pi * sb, *b_pj = b + (size_t) pj * sb;
+  ELEM *at_i = at + (size_t) i * sat, *at_j = at + (size_t) j * sat;
+  ELEM *bt_pi = bt + (size_t) pi * sbt, *bt_pj = bt + (size_t) pj * sbt;
+  int k, pk;
+  COST d = 0;
+
+  for (k = 0; k < size; k++)
+    {
+      pk = sol[k];
+      d += ((COST) at_i[k] - at_j[k]) * ((COST) bt_pj[pk] - bt_pi[pk]) +
+	   ((COST) a_i[k] - a_j[k]) * ((COST) b_pj[pk] - b_pi[pk]);
+    }
+
+  d -= ((COST) at_i[i] - at_j[i]) * ((COST) bt_pj[pi] - bt_pi[pi]) + ((COST) a_i[i] - a_j[i]) * ((COST) b_pj[pi] - b_pi[pi]) +
+       ((COST) at_i[j] - at_j[j]) * ((COST) bt_pj[pj] - bt_pi[pj]) + ((COST) a_i[j] - a_j[j]) * ((COST) b_pj[pj] - b_pi[pj]);
+
+  d += ((COST) a_i[i] - a_j[j]) * ((COST) b_pj[pj] - b_pi[pi]) +
+       ((COST) a_i[j] - a_j[i]) * ((COST) b_pj[pi] - b_pi[pj]);
+
+  return d;
+}
+
+
+/*
+ *  As Compute_Delta_Gen_T using the permuted distance matrix and its transpose
+ *  (all rows are contiguous: the sums are done by the kernel)
+ */
+static inline COST
+FCT(Compute_Delta_Gen_PB_T)(QAPInfo qi, int i, int j)
+{
+  int size = qi->inst->size;
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *at = MAT(qi->inst->at);
+  int sat = qi->inst->at->stride;
+  ELEM *pb = MAT(qi->pb);
+  int spb = qi->pb->stride;
+  ELEM *pbt = MAT(qi->pbt);
+  int spbt = qi->pbt->stride;
+  ELEM *a_i = a + (size_t) i * sa, *a_j = a + (size_t) j * sa;
+  ELEM *at_i = at + (size_t) i * sat, *at_j = at + (size_t) j * sat;
+  ELEM *pb_i = pb + (size_t) i * spb, *pb_j = pb + (size_t) j * spb;
+  ELEM *pbt_i = pbt + (size_t) i * spbt, *pbt_j = pbt + (size_t) j * spbt;
+  COST d = FCT(Dot_Diff)(at_i, at_j, pbt_j, pbt_i, size) +
+          FCT(Dot_Diff)(a_i, a_j, pb_j, pb_i, size);
+
+  d -= ((COST) at_i[i] - at_j[i]) * ((COST) pbt_j[i] - pbt_i[i]) + ((COST) a_i[i] - a_j[i]) * ((COST) pb_j[i] - pb_i[i]) +
+       ((COST) at_i[j] - at_j[j]) * ((COST) pbt_j[j] - pbt_i[j]) + ((COST) a_i[j] - a_j[j]) * ((COST) pb_j[j] - pb_i[j]);
+
+  d += ((COST) a_i[i] - a_j[j]) * ((COST) pb_j[j] - pb_i[i]) +
+       ((COST) a_i[j] - a_j[i]) * ((COST) pb_j[i] - pb_i[j]);
+
+  return d;
+}
+
+
+/*
+ *  As Compute_Delta_Sym / Compute_Delta_Gen_T for a sparse a: the sums over k
+ *  only visit the nonzeros of rows i and j of a (a_csr) and of its columns i
+ *  and j (at_csr), the terms k = i and k = j are removed after.
+ */
+static inline COST
+FCT(Compute_Delta_Sparse)(QAPInfo qi, int i, int j)
+{
+  QAPSparseMatrix csr = qi->inst->a_csr;
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *b = MAT(qi->inst->kb);
+  int sb = qi->inst->kb->stride;
+  QAPVector sol = qi->sol;
+  int pi = sol[i];
+  int pj = sol[j];
+  ELEM *a_i = a + (size_t) i * sa, *a_j = a + (size_t) j * sa;
+  ELEM *b_pi = b + (size_t) pi * sb, *b_pj = b + (size_t) pj * sb;
+  int e, pk;
+  COST d = 0;
+
+  for (e = csr->row_start[i]; e < csr->row_start[i + 1]; e++)
+    {
+      pk = sol[csr->col[e]];
+      d += (COST) csr->val[e] * ((COST) b_pj[pk] - b_pi[pk]);
+    }
+
+  for (e = csr->row_start[j]; e < csr->row_start[j + 1]; e++)
+    {
+      pk = sol[csr->col[e]];
+      d -= (COST) csr->val[e] * ((COST) b_pj[pk] - b_pi[pk]);
+    }
+
+  d -= ((COST) a_i[i] - a_j[i]) * ((COST) b_pj[pi] - b_pi[pi]) +
+       ((COST) a_i[j] - a_j[j]) * ((COST) b_pj[pj] - b_pi[pj]);
+
+  if (qi->inst->symmetric)
+    {
+      d *= 2;
+      if (!qi->inst->zero_diag)
+	d += ((COST) a_i[i] - a_j[j]) * ((COST) b_pj[pj] - b_pi[pi]);
+
+      return d;
+    }
+
+  csr = qi->inst->at_csr;		/* columns of a: (a[k][i] - a[k][j]) * (b[pk][pj] - b[pk][pi]) */
+
+  for (e = csr->row_start[i]; e < csr->row_start[i + 1]; e++)
+    {
+      ELEM *b_pk = b + (size_t) sol[csr->col[e]] * sb;
+      d += (COST) csr->val[e] * ((COST) b_pk[pj] - b_pk[pi]);
+    }
+
+  for (e = csr->row_start[j]; e < csr->row_start[j + 1]; e++)
+    {
+      ELEM *b_pk = b + (size_t) sol[csr->col[e]] * sb;
+      d -= (COST) csr->val[e] * ((COST) b_pk[pj] - b_pk[pi]);
+    }
+
+  d -= ((COST) a_i[i] - a_i[j]) * ((COST) b_pi[pj] - b_pi[pi]) +
+       ((COST) a_j[i] - a_j[j]) * ((COST) b_pj[pj] - b_pj[pi]);
+
+  d += ((COST) a_i[i] - a_j[j]) * ((COST) b_pj[pj] - b_pi[pi]) +
+       ((COST) a_i[j] - a_j[i]) * ((COST) b_pj[pi] - b_pi[pj]);
+
+  return d;
+}
+
+
+/*
+ *  Computes the cost difference if elements i and j are permuted
+ *  (selects the right version)
+ */
+static COST
+FCT(Compute_Delta)(QAPInfo qi, int i, int j)
+{
+  if (qi->inst->a_csr != NULL)
+    return FCT(Compute_Delta_Sparse)(qi, i, j);
+
+  if (qi->inst->symmetric)
+    return (qi->pb != NULL) ? FCT(Compute_Delta_Sym_PB)(qi, i, j) : FCT(Compute_Delta_Sym)(qi, i, j);
+
+  if (qi->inst->bt != NULL || qi->pbt != NULL)	/* at is then also there */
+    return (qi->pb != NULL) ? FCT(Compute_Delta_Gen_PB_T)(qi, i, j) : FCT(Compute_Delta_Gen_T)(qi, i, j);
+
+  return (qi->pb != NULL) ? FCT(Compute_Delta_Gen_PB)(qi, i, j) : FCT(Compute_Delta_Gen)(qi, i, j);
+}
+
+
+static void
+FCT(Store_Delta)(QAPInfo qi, int i, int j)
+{
+  ((COST *) qi->delta->DELTA_DATA)[qi->delta->row_off[i] + j] = FCT(Compute_Delta)(qi, i, j);
+}
+
+
+/*
+ *  As Compute_Delta: computes the cost difference if elements i and j are permuted
+ *  but the value of delta[i][j] is supposed to be known before
+ *  the transposition of elements r and s.
+ *  (general case)
+ */
+static inline COST
+FCT(Compute_Delta_Part_Gen)(QAPInfo qi, int i, int j, int r, int s)
+{
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *b = MAT(qi->inst->kb);
+  int sb = qi->inst->kb->stride;
+  QAPVector sol = qi->sol;
+  int pi = sol[i];
+  int pj = sol[j];
+  int pr = sol[r];
+  int ps = sol[s];
+  ELEM *a_i = a + (size_t) i * sa, *a_j = a + (size_t) j * sa;
+  ELEM *a_r = a + (size_t) r * sa, *a_s = a + (size_t) s * sa;
+  ELEM *b_pi = b + (size_t) pi * sb, *b_pj = b + (size_t) pj * sb;
+  ELEM *b_pr = b + (size_t) pr * sb, *b_ps = b + (size_t) ps * sb;
+
+  return
+    ((COST) a_r[i] - a_r[j] + a_s[j] - a_s[i]) *
+    ((COST) b_ps[pi] - b_ps[pj] + b_pr[pj] - b_pr[pi]) +
+    ((COST) a_i[r] - a_j[r] + a_j[s] - a_i[s]) *
+    ((COST) b_pi[ps] - b_pj[ps] + b_pj[pr] - b_pi[pr]);
+}
+
+
+/*
+ *  As Compute_Delta_Part_Gen (symmetric case)
+ */
+static inline COST
+FCT(Compute_Delta_Part_Sym)(QAPInfo qi, int i, int j, int r, int s)
+{
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *b = MAT(qi->inst->kb);
+  int sb = qi->inst->kb->stride;
+  QAPVector sol = qi->sol;
+  int pi = sol[i];
+  int pj = sol[j];
+  ELEM *a_r = a + (size_t) r * sa, *a_s = a + (size_t) s * sa;
+  ELEM *b_pr = b + (size_t) sol[r] * sb, *b_ps = b + (size_t) sol[s] * sb;
+
+  return 2 *
+    ((COST) a_r[i] - a_r[j] + a_s[j] - a_s[i]) *
+    ((COST) b_ps[pi] - b_ps[pj] + b_pr[pj] - b_pr[pi]);
+}
+
+
+/*
+ *  As Compute_Delta_Part_Gen using the permuted distance matrix
+ */
+static inline COST
+FCT(Compute_Delta_Part_Gen_PB)(QAPInfo qi, int i, int j, int r, int s)
+{
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *pb = MAT(qi->pb);
+  int spb = qi->pb->stride;
+  ELEM *a_i = a + (size_t) i * sa, *a_j = a + (size_t) j * sa;
+  ELEM *a_r = a + (size_t) r * sa, *a_s = a + (size_t) s * sa;
+  ELEM *pb_i = pb + (size_t) i * spb, *pb_j = pb + (size_t) j * spb;
+  ELEM *pb_r = pb + (size_t) r * spb, *pb_s = pb + (size_t) s * spb;
+
+  return
+    ((COST) a_r[i] - a_r[j] + a_s[j] - a_s[i]) *
+    ((COST) pb_s[i] - pb_s[j] + pb_r[j] - pb_r[i]) +
+    ((COST) a_i[r] - a_j[r] + a_j[s] - a_i[s]) *
+    ((COST) pb_i[s] - pb_j[s] + pb_j[r] - pb_i[r]);
+}
+
+
+/*
+ *  As Compute_Delta_Part_Sym using the permuted distance matrix
+ */
+static inline COST
+FCT(Compute_Delta_Part_Sym_PB)(QAPInfo qi, int i, int j, int r, int s)
+{
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *pb = MAT(qi->pb);
+  int spb = qi->pb->stride;
+  ELEM *a_r = a + (size_t) r * sa, *a_s = a + (size_t) s * sa;
+  ELEM *pb_r = pb + (size_t) r * spb, *pb_s = pb + (size_t) s * spb;
+
+  return 2 *
+    ((COST) a_r[i] - a_r[j] + a_s[j] - a_s[i]) *
+    ((COST) pb_s[i] - pb_s[j] + pb_r[j] - pb_r[i]);
+}
+
+
+/*
+ *  Computes the update of delta[i][j] after a swap of r and s
+ *  (selects the right version)
+ */
+static inline COST
+FCT(Compute_Delta_Part)(QAPInfo qi, int i, int j, int r, int s)
+{
+  if (qi->pb != NULL)
+    return (qi->inst->symmetric) ? FCT(Compute_Delta_Part_Sym_PB)(qi, i, j, r, s) : FCT(Compute_Delta_Part_Gen_PB)(qi, i, j, r, s);
+
+  return (qi->inst->symmetric) ? FCT(Compute_Delta_Part_Sym)(qi, i, j, r, s) : FCT(Compute_Delta_Part_Gen)(qi, i, j, r, s);
+}
+
+
+static void
+FCT(Add_Delta_Part)(QAPInfo qi, int i, int j, int r, int s)
+{
+  ((COST *) qi->delta->DELTA_DATA)[qi->delta->row_off[i] + j] += FCT(Compute_Delta_Part)(qi, i, j, r, s);
+}
+
+
+/*
+ *  Stores the transpose of src into dst
+ */
+static void
+FCT(Transpose_Into)(QAPMatrix mat_dst, QAPMatrix mat_src)
+{
+  int size = mat_src->size;
+  ELEM *src = MAT(mat_src);
+  int ss = mat_src->stride;
+  ELEM *dst = MAT(mat_dst);
+  int sd = mat_dst->stride;
+  int i, j;
+
+  for (i = 0; i < size; i++)
+    for (j = 0; j < size; j++)
+      dst[(size_t) j * sd + i] = src[(size_t) i * ss + j];
+}
+
+
+/*
+ *  Computes the rows [task_no * DELTA_TASK_ROWS, (task_no + 1) * DELTA_TASK_ROWS[
+ *  of delta (a task of Compute_All_Delta)
+ *
+ *  The columns are processed by tiles: the rows j of a tile are reused for all
+ *  rows i of the task.
+ */
+static void
+FCT(Compute_Delta_Rows)(void *arg, int task_no)
+{
+  QAPInfo qi = arg;
+  int size = qi->inst->size;
+  COST *delta = (COST *) qi->delta->DELTA_DATA;
+  size_t *row_off = qi->delta->row_off;
+  int i0 = task_no * DELTA_TASK_ROWS;
+  int i_end = (i0 + DELTA_TASK_ROWS < size) ? i0 + DELTA_TASK_ROWS : size;
+  int i, j, j0;
+
+  for (j0 = i0 + 1; j0 < size; j0 += DELTA_TILE_COLS)
+    {
+      int j_end = (j0 + DELTA_TILE_COLS < size) ? j0 + DELTA_TILE_COLS : size;
+
+      for (i = i0; i < i_end; i++)
+	for (j = (i + 1 > j0) ? i + 1 : j0; j < j_end; j++)
+	  delta[row_off[i] + j] = FCT(Compute_Delta)(qi, i, j);
+    }
+}
+
+
+/*
+ *  Takes into account the row i of delta (i, j) for j > i in the minima of i and j
+ *  (see QAP_Track_Row_Minima)
+ */
+static inline void
+FCT(Row_Min_Row)(QAPInfo qi, int i)
+{
+  int size = qi->inst->size;
+  COST *delta_i = (COST *) qi->delta->DELTA_DATA + qi->delta->row_off[i];
+  QAPRowMin *row_min = qi->row_min;
+  unsigned (*random)(unsigned n) = qi->row_min_random;
+  int j;
+
+  for (j = i + 1; j < size; j++)
+    {
+      Row_Min_Add(row_min + i, j, delta_i[j], random);
+      Row_Min_Add(row_min + j, i, delta_i[j], random);
+    }
+}
+
+
+/*
+ *  Computes the minima of all the rows of delta (see QAP_Track_Row_Minima)
+ */
+static void
+FCT(Row_Minima)(QAPInfo qi)
+{
+  int size = qi->inst->size;
+  int i;
+
+  Row_Min_Reset(qi);
+  for (i = 0; i < size - 1; i++)
+    FCT(Row_Min_Row)(qi, i);
+}
+
+
+/*
+ *  Computes the entire delta matrix
+ *
+ *  Unless a is sparse, a temporary permuted distance matrix (and its
+ *  transpose if not symmetric) is built if not maintained: each delta is then
+ *  made of contiguous dot products (done by the kernel, with at built at load).
+ *  The cost of this O(n^2) step is negligible w.r.t. the O(n^3) computation
+ *  and the matrices are freed after (they would double the memory of a
+ *  solving state).
+ *  The rows are split into tasks run by the thread pool. All computations
+ *  are done on integers so the result does not depend on the order nor on
+ *  the number of threads.
+ */
+static void
+FCT(Compute_All_Delta)(QAPInfo qi)
+{
+  struct qap_info qi_dot = *qi;	/* qi with all the matrices for the dot products */
+  int size = qi->inst->size;
+  int nb_tasks = (size + DELTA_TASK_ROWS - 1) / DELTA_TASK_ROWS;
+  QAPMatrix pb = NULL, pbt = NULL;
+  int i;
+
+  if (qi->inst->a_csr == NULL)
+    {
+      if (qi->pb == NULL)
+	{
+	  pb = qi_dot.pb = QAP_Alloc_Matrix_Width(size, qi->inst->width);
+	  FCT(Compute_Permuted_Matrix)(pb, qi->inst->kb, qi->sol);
+	}
+
+      if (!qi->inst->symmetric && qi->pbt == NULL)
+	{
+	  pbt = qi_dot.pbt = QAP_Alloc_Matrix_Width(size, qi->inst->width);
+	  FCT(Transpose_Into)(pbt, qi_dot.pb);
+	}
+    }
+
+  if (size >= DELTA_MIN_PAR_SIZE)
+    Thread_Pool_Run(FCT(Compute_Delta_Rows), &qi_dot, nb_tasks);
+  else
+    for (i = 0; i < nb_tasks; i++)
+      FCT(Compute_Delta_Rows)(&qi_dot, i);
+
+  if (pb != NULL)
+    QAP_Free_Matrix(pb);
+  if (pbt != NULL)
+    QAP_Free_Matrix(pbt);
+
+  if (qi->row_min != NULL)
+    FCT(Row_Minima)(qi);
+}
+
+
+/*
+ *  Records a swap with the scalar kernel (original code)
+ */
+static void
+FCT(Executed_Swap_Scalar)(QAPInfo qi, int i1, int i2)
+{
+  int size = qi->inst->size;
+  COST *delta = (COST *) qi->delta->DELTA_DATA;
+  size_t *row_off = qi->delta->row_off;
+  int i, j;
+
+  for (i = 0; i < size; i++)
+    for (j = i + 1; j < size; j++)
+      if (i != i1 && i != i2 && j != i1 && j != i2)
+	delta[row_off[i] + j] += FCT(Compute_Delta_Part)(qi, i, j, i1, i2);
+      else
+	delta[row_off[i] + j] = FCT(Compute_Delta)(qi, i, j);
+
+  if (qi->row_min != NULL)
+    FCT(Row_Minima)(qi);
+}
+
+
+/*
+ *  Computes the swap vectors u, v (and u2, v2 if not symmetric) after a swap
+ *  of i1 and i2 (see the delta update kernels in qap-utils.c)
+ */
+static void
+FCT(Swap_Vectors)(QAPInfo qi, int i1, int i2)
+{
+  int size = qi->inst->size;
+  ELEM *a = MAT(qi->inst->ka);
+  int sa = qi->inst->ka->stride;
+  ELEM *b = MAT(qi->inst->kb);
+  int sb = qi->inst->kb->stride;
+  QAPVector sol = qi->sol;
+  COST *u = (COST *) qi->swap_vec, *v = u + size;
+  COST *u2 = v + size, *v2 = u2 + size;
+  ELEM *a_r = a + (size_t) i1 * sa, *a_s = a + (size_t) i2 * sa;
+  int k;
+
+  for (k = 0; k < size; k++)
+    u[k] = (COST) a_s[k] - a_r[k];
+
+  if (qi->pb != NULL)		/* pb[x][y] replaces b[sol[x]][sol[y]] */
+    {
+      ELEM *pb = MAT(qi->pb);
+      int spb = qi->pb->stride;
+      ELEM *pb_r = pb + (size_t) i1 * spb, *pb_s = pb + (size_t) i2 * spb;
+
+      for (k = 0; k < size; k++)
+	v[k] = (COST) pb_r[k] - pb_s[k];
+
+      if (qi->pbt != NULL)
+	{
+	  ELEM *pbt = MAT(qi->pbt);
+	  int spbt = qi->pbt->stride;
+	  ELEM *pbt_r = pbt + (size_t) i1 * spbt, *pbt_s = pbt + (size_t) i2 * spbt;
+
+	  for (k = 0; k < size; k++)
+	    v2[k] = (COST) pbt_r[k] - pbt_s[k];
+	}
+      else if (!qi->inst->symmetric)
+	for (k = 0; k < size; k++)
+	  {
+	    ELEM *pb_k = pb + (size_t) k * spb;
+	    v2[k] = (COST) pb_k[i1] - pb_k[i2];
+	  }
+    }
+  else
+    {
+      int pr = sol[i1], ps = sol[i2];
+      ELEM *b_pr = b + (size_t) pr * sb, *b_ps = b + (size_t) ps * sb;
+
+      for (k = 0; k < size; k++)
+	v[k] = (COST) b_pr[sol[k]] - b_ps[sol[k]];
+
+      if (qi->inst->bt != NULL)
+	{
+	  ELEM *bt = MAT(qi->inst->bt);
+	  int sbt = qi->inst->bt->stride;
+	  ELEM *bt_pr = bt + (size_t) pr * sbt, *bt_ps = bt + (size_t) ps * sbt;
+
+	  for (k = 0; k < size; k++)
+	    v2[k] = (COST) bt_pr[sol[k]] - bt_ps[sol[k]];
+	}
+      else if (!qi->inst->symmetric)
+	for (k = 0; k < size; k++)
+	  {
+	    ELEM *b_pk = b + (size_t) sol[k] * sb;
+	    v2[k] = (COST) b_pk[pr] - b_pk[ps];
+	  }
+    }
+
+  if (qi->inst->symmetric)
+    return;
+
+  if (qi->inst->at != NULL)
+    {
+      ELEM *at = MAT(qi->inst->at);
+      int sat = qi->inst->at->stride;
+      ELEM *at_r = at + (size_t) i1 * sat, *at_s = at + (size_t) i2 * sat;
+
+      for (k = 0; k < size; k++)
+	u2[k] = (COST) at_s[k] - at_r[k];
+    }
+  else
+    for (k = 0; k < size; k++)
+      {
+	ELEM *a_k = a + (size_t) k * sa;
+	u2[k] = (COST) a_k[i2] - a_k[i1];
+      }
+}
+
+
+/*
+ *  Recomputes entirely the entries involving i1 or i2
+ */
+static void
+FCT(Recompute_Swapped)(QAPInfo qi, int i1, int i2)
+{
+  int size = qi->inst->size;
+  int k;
+
+  for (k = 0; k < size; k++)
+    {
+      if (k != i1)
+	FCT(Store_Delta)(qi, (k < i1) ? k : i1, (k < i1) ? i1 : k);
+      if (k != i1 && k != i2)
+	FCT(Store_Delta)(qi, (k < i2) ? k : i2, (k < i2) ? i2 : k);
+    }
+}
+
+
+/*
+ *  Records a swap with a sparse a
+ *
+ *  delta[i][j] only changes if u[i] != u[j] or u2[i] != u2[j], i.e. if i or j
+ *  is in the support of u and u2 (the elements whose flows to i1 and i2 differ).
+ *  Only the rows and the columns of delta of this support are updated:
+ *  O(support * n) instead of O(n^2).
+ */
+static void
+FCT(Executed_Swap_Sparse)(QAPInfo qi, int i1, int i2)
+{
+  int size = qi->inst->size;
+  COST *delta = (COST *) qi->delta->DELTA_DATA;
+  size_t *row_off = qi->delta->row_off;
+  COST *u = (COST *) qi->swap_vec, *v = u + size;
+  COST *u2 = v + size, *v2 = u2 + size;
+  int *supp = (int *) (v2 + size), *in_supp = supp + size;
+  int nb_supp = 0;
+  int i, j, k, l;
+
+  FCT(Swap_Vectors)(qi, i1, i2);
+
+  if (qi->inst->symmetric)		/* u2 = u, v2 = v: the update is 2 * (u[j] - u[i]) * (v[j] - v[i]) */
+    {
+      u2 = u;
+      v2 = v;
+    }
+
+  for (k = 0; k < size; k++)
+    if (k != i1 && k != i2 && (u[k] != 0 || u2[k] != 0))
+      {
+	supp[nb_supp++] = k;
+	in_supp[k] = 1;
+      }
+
+  for (l = 0; l < nb_supp; l++)
+    {
+      k = supp[l];
+
+      COST *delta_k = delta + row_off[k];	/* row k: (k, j) for j > k */
+
+      if (kernel->UPDATE_ROW_SYM == NULL)
+	for (j = k + 1; j < size; j++)
+	  delta_k[j] += (u[j] - u[k]) * (v[j] - v[k]) + (u2[j] - u2[k]) * (v2[j] - v2[k]);
+      else if (qi->inst->symmetric)
+	(*kernel->UPDATE_ROW_SYM)(delta_k + k + 1, size - 1 - k, u + k + 1, v + k + 1, u[k], v[k]);
+      else
+	(*kernel->UPDATE_ROW_GEN)(delta_k + k + 1, size - 1 - k, u + k + 1, v + k + 1, u2 + k + 1, v2 + k + 1,
+				  u[k], v[k], u2[k], v2[k]);
+
+      for (i = 0; i < k; i++)	/* column k: (i, k) for i < k (if i is in the support: done by row i) */
+	if (!in_supp[i])
+	  delta[row_off[i] + k] += (u[k] - u[i]) * (v[k] - v[i]) + (u2[k] - u2[i]) * (v2[k] - v2[i]);
+    }
+
+  for (l = 0; l < nb_supp; l++)
+    in_supp[supp[l]] = 0;
+
+  FCT(Recompute_Swapped)(qi, i1, i2);
+
+  if (qi->row_min != NULL)	/* only some rows are updated: no by-product */
+    FCT(Row_Minima)(qi);
+}
+
+
+/*
+ *  Records a swap (to be called once a swap has been done)
+ */
+static void
+FCT(Executed_Swap)(QAPInfo qi, int i1, int i2)
+{
+  if (qi->pb != NULL)
+    FCT(Swap_Permuted_Matrix)(qi->pb, i1, i2);
+
+  if (qi->pbt != NULL)
+    FCT(Swap_Permuted_Matrix)(qi->pbt, i1, i2);
+
+  if (qi->inst->a_csr != NULL)
+    {
+      FCT(Executed_Swap_Sparse)(qi, i1, i2);
+      return;
+    }
+
+  if (kernel->UPDATE_ROW_SYM == NULL)
+    {
+      FCT(Executed_Swap_Scalar)(qi, i1, i2);
+      return;
+    }
+
+  int size = qi->inst->size;
+  COST *delta = (COST *) qi->delta->DELTA_DATA;
+  size_t *row_off = qi->delta->row_off;
+  COST *u = (COST *) qi->swap_vec, *v = u + size;
+  COST *u2 = v + size, *v2 = u2 + size;
+  int i, j;
+
+  FCT(Swap_Vectors)(qi, i1, i2);
+
+  if (qi->row_min != NULL)
+    Row_Min_Reset(qi);
+
+  /* the entries involving i1 or i2 are recomputed entirely, the others are
+   * updated. Each row is complete once processed: its minima are computed
+   * while it is in cache (see QAP_Track_Row_Minima) */
+
+  for (i = 0; i < size - 1; i++)
+    {
+      COST *delta_i = delta + row_off[i];
+
+      if (i == i1 || i == i2)
+	for (j = i + 1; j < size; j++)
+	  delta_i[j] = FCT(Compute_Delta)(qi, i, j);
+      else
+	{
+	  if (qi->inst->symmetric)
+	    (*kernel->UPDATE_ROW_SYM)(delta_i + i + 1, size - 1 - i, u + i + 1, v + i + 1, u[i], v[i]);
+	  else
+	    (*kernel->UPDATE_ROW_GEN)(delta_i + i + 1, size - 1 - i, u + i + 1, v + i + 1, u2 + i + 1, v2 + i + 1,
+				      u[i], v[i], u2[i], v2[i]);
+	  if (i1 > i)
+	    delta_i[i1] = FCT(Compute_Delta)(qi, i, i1);
+	  if (i2 > i)
+	    delta_i[i2] = FCT(Compute_Delta)(qi, i, i2);
+	}
+
+      if (qi->row_min != NULL)
+	FCT(Row_Min_Row)(qi, i);
+    }
+}
+
+
+/*
+ *  Installs qi->sol: permuted matrices, cost and all deltas
+ */
+static void
+FCT(Set_Solution)(QAPInfo qi)
+{
+  if (qi->pb != NULL)
+    FCT(Compute_Permuted_Matrix)(qi->pb, qi->inst->kb, qi->sol);
+
+  if (qi->pbt != NULL)
+    FCT(Compute_Permuted_Matrix)(qi->pbt, qi->inst->bt, qi->sol);
+
+  qi->cost = FCT(Cost_Of_Solution)(qi);
+
+  FCT(Compute_All_Delta)(qi);
+}
+
+
+#undef MAT
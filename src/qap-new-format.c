@@ -27,19 +27,19 @@ main(int argc, char *argv[])
 
 
   qi = QAP_Load_Problem(argv[1 + exchange], 0);
-  n = qi->size;
-  a = (!exchange) ? qi->a : qi->b;
-  b = (!exchange) ? qi->b : qi->a;
+  n = qi->inst->size;
+  a = (!exchange) ? qi->inst->a : qi->inst->b;
+  b = (!exchange) ? qi->inst->b : qi->inst->a;
 
   int max = 0;
 
   for (i = 0; i < n; i++)
     for (j = 0; j < n; j++)
       {
-	if (a[i][j] > max)
-	  max = a[i][j];
-	if (b[i][j] > max)
-	  max = b[i][j];
+	if (QAP_Elem(a, i, j) > max)
+	  max = QAP_Elem(a, i, j);
+	if (QAP_Elem(b, i, j) > max)
+	  max = QAP_Elem(b, i, j);
       }
 
   int nb10 = 0;
@@ -51,16 +51,16 @@ main(int argc, char *argv[])
       max10 *= 10;
     }
 
-  if (qi->opt <= 0)
-    qi->opt = -qi->bound;
+  if (qi->inst->opt <= 0)
+    qi->inst->opt = -qi->inst->bound;
 
-  printf("%d %d %d\n", qi->size, qi->opt, qi->bks);
+  printf("%d %lld %lld\n", qi->inst->size, qi->inst->opt, qi->inst->bks);
   for(i = 0; i < n; i++)
     {
       int c = '\n';
       for (j = 0; j < n; j++)
 	{
-	  printf("%c%*d", c, nb10, a[i][j]);
+	  printf("%c%*d", c, nb10, QAP_Elem(a, i, j));
 	  c = ' ';
 	}
     }
@@ -71,7 +71,7 @@ main(int argc, char *argv[])
       int c = '\n';
       for (j = 0; j < n; j++)
 	{
-	  printf("%c%*d", c, nb10, b[i][j]);
+	  printf("%c%*d", c, nb10, QAP_Elem(b, i, j));
 	  c = ' ';
 	}
     }
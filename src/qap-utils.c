@@ -11,9 +11,17 @@
 #include <string.h>
 #include <ctype.h>
 #include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "qap-utils.h"
 
+static void Select_Engine(QAPInstance inst);
+
+static void Thread_Pool_Run(void (*fct)(void *arg, int task_no), void *arg, int nb_tasks);
+
+static double sparse_density = QAP_SPARSE_DENSITY;
+
 QAPVector
 QAP_Alloc_Vector(int size)
 {
@@ -28,11 +36,30 @@ QAP_Alloc_Vector(int size)
 
 
 
+/*
+ *  Allocates a size x size matrix (initialized with 0)
+ *
+ *  All rows are stored in one block aligned on a cache line. Each row is
+ *  padded to a multiple of the cache line size (stride), avoiding strides
+ *  which are a multiple of 1024 bytes (cache set conflicts on column walks).
+ */
 QAPMatrix
 QAP_Alloc_Matrix(int size)
 {
-  QAPMatrix mat = calloc(size, sizeof(mat[0]));
-  int i;
+  return QAP_Alloc_Matrix_Width(size, sizeof(int));
+}
+
+
+/*
+ *  As QAP_Alloc_Matrix for elements of elem_size bytes (1, 2 or sizeof(int))
+ */
+QAPMatrix
+QAP_Alloc_Matrix_Width(int size, int elem_size)
+{
+  QAPMatrix mat = calloc(1, sizeof(*mat));
+  int elems_per_line = QAP_CACHE_LINE_SIZE / elem_size;
+  int stride = (size + elems_per_line - 1) / elems_per_line * elems_per_line;
+  size_t bytes;
 
   if (mat == NULL)
     {
@@ -40,21 +67,78 @@ QAP_Alloc_Matrix(int size)
       exit(1);
     }
 
-  for(i = 0; i < size; i++)
+  if (stride > 0 && (stride * elem_size) % 1024 == 0)
+    stride += elems_per_line;
+
+  bytes = (size_t) size * stride * elem_size;
+  if (bytes == 0)
+    bytes = QAP_CACHE_LINE_SIZE;
+
+  mat->size = size;
+  mat->stride = stride;
+  mat->elem_size = elem_size;
+  mat->data = aligned_alloc(QAP_CACHE_LINE_SIZE, bytes); /* bytes is a multiple of the alignment */
+  if (mat->data == NULL)
     {
-      mat[i] = QAP_Alloc_Vector(size);
+      fprintf(stderr, "%s:%d aligned_alloc failed\n", __FILE__, __LINE__);
+      exit(1);
     }
+  memset(mat->data, 0, bytes);
 
   return mat;
 }
 
 void
-QAP_Free_Matrix(QAPMatrix mat, int size)
+QAP_Free_Matrix(QAPMatrix mat)
+{
+  free(mat->data);
+  free(mat);
+}
+
+
+
+/*
+ *  Allocates a packed strictly upper triangular size x size matrix
+ *  (initialized with 0) for elements of elem_size bytes
+ *
+ *  The rows are stored one after the other without padding: the whole
+ *  matrix can be scanned with a single increasing index (element 0 is unused).
+ */
+QAPTriMatrix
+QAP_Alloc_Tri_Matrix(int size, int elem_size)
 {
+  QAPTriMatrix mat = calloc(1, sizeof(*mat));
+  size_t nb_elems = 1 + (size_t) size * (size - 1) / 2;
+  size_t bytes = (nb_elems * elem_size + QAP_CACHE_LINE_SIZE - 1) / QAP_CACHE_LINE_SIZE * QAP_CACHE_LINE_SIZE;
   int i;
-  for(i = 0; i < size; i++)
-    free(mat[i]);
 
+  if (mat == NULL || (mat->row_off = malloc(size * sizeof(size_t))) == NULL)
+    {
+      fprintf(stderr, "%s:%d malloc failed\n", __FILE__, __LINE__);
+      exit(1);
+    }
+
+  for (i = 0; i < size; i++)	/* row i holds the size - 1 - i elements (i, j > i) */
+    mat->row_off[i] = (size_t) i * (size - 1) - (size_t) i * (i + 1) / 2;
+
+  mat->size = size;
+  mat->elem_size = elem_size;
+  mat->data = aligned_alloc(QAP_CACHE_LINE_SIZE, bytes); /* bytes is a multiple of the alignment */
+  if (mat->data == NULL)
+    {
+      fprintf(stderr, "%s:%d aligned_alloc failed\n", __FILE__, __LINE__);
+      exit(1);
+    }
+  memset(mat->data, 0, bytes);
+
+  return mat;
+}
+
+void
+QAP_Free_Tri_Matrix(QAPTriMatrix mat)
+{
+  free(mat->row_off);
+  free(mat->data);
   free(mat);
 }
 
@@ -68,7 +152,7 @@ QAP_Read_Matrix(FILE *f, int size)
 
   for(i = 0; i < size; i++)
     for(j = 0; j < size; j++)
-      if (fscanf(f, "%d", &(m[i][j])) != 1)
+      if (fscanf(f, "%d", &QAP_Elem(m, i, j)) != 1)
 	{
 	  fprintf(stderr, "error while reading matrix at [%d][%d]\n", i, j);
 	  exit(1);
@@ -89,8 +173,9 @@ QAP_Display_Vector(QAPVector sol, int size)
 
 
 void
-QAP_Display_Matrix(QAPMatrix mat, int size)
+QAP_Display_Matrix(QAPMatrix mat)
 {
+  int size = mat->size;
   int i, j;
   int width = 0;
   char buff[32] = "";
@@ -98,7 +183,7 @@ QAP_Display_Matrix(QAPMatrix mat, int size)
   for (i = 0; i < size; i++)
     for (j = 0; j < size; j++)
       {
-	sprintf(buff, "%d", mat[i][j]);
+	sprintf(buff, "%d", QAP_Elem(mat, i, j));
 	int l = strlen(buff);
         if (l > width)
           width = l;
@@ -109,7 +194,7 @@ QAP_Display_Matrix(QAPMatrix mat, int size)
       char *pref = "";
       for (j = 0; j < size; j++)
         {
-          printf("%s%*d", pref, width, mat[i][j]);
+          printf("%s%*d", pref, width, QAP_Elem(mat, i, j));
           pref = " ";
         }
       printf("\n");
@@ -118,6 +203,247 @@ QAP_Display_Matrix(QAPMatrix mat, int size)
 
 
 
+/*
+ *  Returns a new matrix: the transpose of mat
+ */
+QAPMatrix
+QAP_Transpose_Matrix(QAPMatrix mat)
+{
+  int size = mat->size;
+  QAPMatrix t = QAP_Alloc_Matrix(size);
+  int i, j;
+
+  for (i = 0; i < size; i++)
+    for (j = 0; j < size; j++)
+      QAP_Elem(t, j, i) = QAP_Elem(mat, i, j);
+
+  return t;
+}
+
+
+/*
+ *  Returns 1 if the matrix is symmetric
+ */
+int
+QAP_Is_Symmetric_Matrix(QAPMatrix mat)
+{
+  int size = mat->size;
+  int i, j;
+
+  for (i = 0; i < size; i++)
+    for (j = i + 1; j < size; j++)
+      if (QAP_Elem(mat, i, j) != QAP_Elem(mat, j, i))
+	return 0;
+
+  return 1;
+}
+
+
+/*
+ *  Returns 1 if the diagonal of the matrix only contains 0
+ */
+int
+QAP_Has_Zero_Diagonal(QAPMatrix mat)
+{
+  int size = mat->size;
+  int i;
+
+  for (i = 0; i < size; i++)
+    if (QAP_Elem(mat, i, i) != 0)
+      return 0;
+
+  return 1;
+}
+
+
+/*
+ *  Returns the narrowest element size able to store the matrix:
+ *  1 (unsigned char) for values in 0..255,
+ *  2 (short) for values in -16384..16383 (differences must fit in a short, see Dot_Diff16_AVX2),
+ *  sizeof(int) otherwise.
+ */
+int
+QAP_Narrowest_Width(QAPMatrix mat)
+{
+  int size = mat->size;
+  int i, j;
+  int min = 0, max = 0;
+
+  for (i = 0; i < size; i++)
+    for (j = 0; j < size; j++)
+      {
+	int x = QAP_Elem(mat, i, j);
+	if (x < min)
+	  min = x;
+	if (x > max)
+	  max = x;
+      }
+
+  if (min >= 0 && max <= UCHAR_MAX)
+    return 1;
+
+  if (min >= -16384 && max <= 16383)
+    return 2;
+
+  return sizeof(int);
+}
+
+
+/*
+ *  Returns 1 if a cost (or a delta) could overflow an int.
+ *
+ *  A cost is bounded by B = min(sum|a| * max|b|, sum|b| * max|a|).
+ *  The partial sums of a delta computation are bounded by 4 * B
+ *  (2 rows and 2 columns of a, each difference of b bounded by 2 * max|b|).
+ *  The engines also form sums of up to 4 elements (e.g. in Compute_Delta_Part
+ *  or u[j] - u[i] in the kernels) and their products: 4 * max|a| * 4 * max|b|.
+ */
+static int
+Cost_May_Overflow(QAPMatrix mat_A, QAPMatrix mat_B)
+{
+  int size = mat_A->size;
+  long long sum_a = 0, sum_b = 0, max_a = 0, max_b = 0;
+  int i, j;
+
+  for (i = 0; i < size; i++)
+    for (j = 0; j < size; j++)
+      {
+	long long x = llabs(QAP_Elem(mat_A, i, j));
+	long long y = llabs(QAP_Elem(mat_B, i, j));
+
+	sum_a += x;
+	sum_b += y;
+	if (x > max_a)
+	  max_a = x;
+	if (y > max_b)
+	  max_b = y;
+      }
+
+  if (max_a > INT_MAX / 4 || max_b > INT_MAX / 4 || 16 * max_a * max_b > INT_MAX)
+    return 1;
+
+  return (max_b != 0 && sum_a > INT_MAX / 4 / max_b) && (max_a != 0 && sum_b > INT_MAX / 4 / max_a);
+}
+
+
+/*
+ *  Returns a new matrix: a copy of the (int) matrix mat with elements of elem_size bytes
+ *  (the values must fit, see QAP_Narrowest_Width)
+ */
+QAPMatrix
+QAP_Narrow_Matrix(QAPMatrix mat, int elem_size)
+{
+  int size = mat->size;
+  QAPMatrix m = QAP_Alloc_Matrix_Width(size, elem_size);
+  int i, j;
+
+  for (i = 0; i < size; i++)
+    for (j = 0; j < size; j++)
+      switch(elem_size)
+	{
+	case 1:
+	  m->data8[(size_t) i * m->stride + j] = QAP_Elem(mat, i, j);
+	  break;
+
+	case 2:
+	  m->data16[(size_t) i * m->stride + j] = QAP_Elem(mat, i, j);
+	  break;
+
+	default:
+	  QAP_Elem(m, i, j) = QAP_Elem(mat, i, j);
+	}
+
+  return m;
+}
+
+
+
+/*
+ *  Returns the fraction of nonzero elements of the matrix
+ */
+double
+QAP_Matrix_Density(QAPMatrix mat)
+{
+  int size = mat->size;
+  long long nnz = 0;
+  int i, j;
+
+  for (i = 0; i < size; i++)
+    for (j = 0; j < size; j++)
+      if (QAP_Elem(mat, i, j) != 0)
+	nnz++;
+
+  return (size == 0) ? 0.0 : (double) nnz / ((double) size * size);
+}
+
+
+/*
+ *  Returns the CSR form of an (int) matrix
+ */
+QAPSparseMatrix
+QAP_Sparse_Matrix(QAPMatrix mat)
+{
+  int size = mat->size;
+  QAPSparseMatrix csr = calloc(1, sizeof(*csr));
+  int i, j, nnz = 0;
+
+  if (csr == NULL)
+    {
+      fprintf(stderr, "%s:%d calloc failed\n", __FILE__, __LINE__);
+      exit(1);
+    }
+
+  for (i = 0; i < size; i++)
+    for (j = 0; j < size; j++)
+      if (QAP_Elem(mat, i, j) != 0)
+	nnz++;
+
+  csr->size = size;
+  csr->nnz = nnz;
+  csr->row_start = QAP_Alloc_Vector(size + 1);
+  csr->col = QAP_Alloc_Vector(nnz + 1);
+  csr->val = QAP_Alloc_Vector(nnz + 1);
+
+  nnz = 0;
+  for (i = 0; i < size; i++)
+    {
+      csr->row_start[i] = nnz;
+      for (j = 0; j < size; j++)
+	if (QAP_Elem(mat, i, j) != 0)
+	  {
+	    csr->col[nnz] = j;
+	    csr->val[nnz] = QAP_Elem(mat, i, j);
+	    nnz++;
+	  }
+    }
+  csr->row_start[size] = nnz;
+
+  return csr;
+}
+
+
+void
+QAP_Free_Sparse_Matrix(QAPSparseMatrix csr)
+{
+  free(csr->row_start);
+  free(csr->col);
+  free(csr->val);
+  free(csr);
+}
+
+
+/*
+ *  Sets the max density of a under which the sparse engine is used
+ *  (to be called before QAP_Load_Problem, 0: never)
+ */
+void
+QAP_Set_Sparse_Density(double max_density)
+{
+  sparse_density = max_density;
+}
+
+
+
 /* dual conversion */
 void
 QAP_Create_Dual_Vector(QAPVector dst, int size, QAPVector src)
@@ -150,20 +476,19 @@ QAP_Switch_To_Dual_Vector(QAPVector sol, int size)
 
 
 /*
- *  Load a QAP problem
+ *  Load a QAP problem instance
  *
  *  file_name: the file name of the QAP problem (can be a .dat or a .qap)
- *  qi: the ptr to the info structure (can be NULL)
- *      the matrix a and b are not allocated if the ptr != NULL at entry !
+ *  flags: a mask of QAP_LOAD_XXX (see qap-utils.h)
  *
- *  Returns the size of the problem
+ *  Returns the instance structure (read-only afterwards, see QAP_New_Info)
  */
-QAPInfo
-QAP_Load_Problem(char *file_name, int header_only)
+QAPInstance
+QAP_Load_Instance(char *file_name, int flags)
 {
   int size;
   FILE *f;
-  QAPInfo qi;
+  QAPInstance inst;
 
   if ((f = fopen(file_name, "rt")) == NULL) {
     perror(file_name);
@@ -176,8 +501,8 @@ QAP_Load_Problem(char *file_name, int header_only)
       exit(1);
     }
 
-  qi = (QAPInfo) calloc(1, sizeof(*qi));
-  if (qi == NULL)
+  inst = (QAPInstance) calloc(1, sizeof(*inst));
+  if (inst == NULL)
     {
       fprintf(stderr, "%s:%d calloc failed\n", __FILE__, __LINE__);
       exit(1);
@@ -185,7 +510,7 @@ QAP_Load_Problem(char *file_name, int header_only)
   
   static char buff[1024];
   char *p = buff;
-  int x[2];
+  QAPCost x[2];
   int nb_x = 0;
   int nb_params_expected = sizeof(x) / sizeof(x[0]);
 
@@ -209,166 +534,986 @@ QAP_Load_Problem(char *file_name, int header_only)
 	  break;
 	}
 
-      x[nb_x++] = strtol(p, &p, 10);      
+      x[nb_x++] = strtoll(p, &p, 10);      
     }
 
-  qi->file_name = file_name;
-  qi->size = size;
-  qi->opt = qi->bks = qi->bound = 0;
+  inst->file_name = file_name;
+  inst->size = size;
+  inst->opt = inst->bks = inst->bound = 0;
 
   switch(nb_x)
     {
     case 1:
-      qi->bks = x[0];	/* we suppose it is a BKS (not sure it is the optimum) */
+      inst->bks = x[0];	/* we suppose it is a BKS (not sure it is the optimum) */
       break;
 
     case 2:
-      qi->opt = x[0];
-      qi->bks = x[1];
+      inst->opt = x[0];
+      inst->bks = x[1];
       break;
     }
 
-  if (qi->opt < 0)
+  if (inst->opt < 0)
     {
-      qi->bound = -qi->opt;
-      qi->opt = 0;
+      inst->bound = -inst->opt;
+      inst->opt = 0;
     }
   else
-    qi->bound = qi->opt;
+    inst->bound = inst->opt;
 
 
-  if (!header_only)
+  if (!(flags & QAP_LOAD_HEADER_ONLY))
     {
-      qi->a = QAP_Read_Matrix(f, size);
-      qi->b = QAP_Read_Matrix(f, size);
+      inst->a = QAP_Read_Matrix(f, size);
+      inst->b = QAP_Read_Matrix(f, size);
+
+      inst->symmetric = QAP_Is_Symmetric_Matrix(inst->a) && QAP_Is_Symmetric_Matrix(inst->b);
+      inst->zero_diag = QAP_Has_Zero_Diagonal(inst->a) || QAP_Has_Zero_Diagonal(inst->b);
 
-      qi->sol = QAP_Alloc_Vector(qi->size);
-      qi->delta = QAP_Alloc_Matrix(qi->size);
+      inst->width = sizeof(int);
+      if (!(flags & QAP_LOAD_NO_NARROW))
+	{
+	  int wa = QAP_Narrowest_Width(inst->a);
+	  int wb = QAP_Narrowest_Width(inst->b);
+	  inst->width = (wa > wb) ? wa : wb;
+	}
+
+      inst->ka = inst->a;
+      inst->kb = inst->b;
+      if (inst->width != sizeof(int))
+	{
+	  inst->ka = QAP_Narrow_Matrix(inst->a, inst->width);
+	  inst->kb = QAP_Narrow_Matrix(inst->b, inst->width);
+	}
+      inst->cost64 = (flags & QAP_LOAD_COST64) || Cost_May_Overflow(inst->a, inst->b);
+      Select_Engine(inst);
+
+      if (sparse_density > 0 && QAP_Matrix_Density(inst->a) <= sparse_density)
+	{
+	  inst->a_csr = QAP_Sparse_Matrix(inst->a);
+	  if (!inst->symmetric)
+	    {
+	      QAPMatrix t = QAP_Transpose_Matrix(inst->a);
+	      inst->at_csr = QAP_Sparse_Matrix(t);
+	      QAP_Free_Matrix(t);
+	    }
+	}
+
+      inst->permuted_b = (flags & QAP_LOAD_PERMUTED_B) != 0;
+
+      if (!inst->symmetric && (inst->a_csr == NULL || (flags & QAP_LOAD_TRANSPOSE))) /* useless if symmetric */
+	{			/* at is always used by the full delta (dot products of rows) */
+	  QAPMatrix t = QAP_Transpose_Matrix(inst->a);
+	  inst->at = QAP_Narrow_Matrix(t, inst->width);
+	  QAP_Free_Matrix(t);
+	}
+
+      if ((flags & QAP_LOAD_TRANSPOSE) && !inst->symmetric)
+	{
+	  QAPMatrix t = QAP_Transpose_Matrix(inst->b);
+	  inst->bt = QAP_Narrow_Matrix(t, inst->width);
+	  QAP_Free_Matrix(t);
+	}
     }
 
   
    
   fclose(f);
   
-  return qi;
+  return inst;
 }
 
 
 
 /*
- *  Computes the cost of a solution
+ *  Returns a new QAPInfo on the problem instance inst with its own solving
+ *  vars (the instance data, e.g. the matrices, are shared: several solving
+ *  states, e.g. one per thread, can use a same instance)
+ *  The solution is not initialized (see QAP_Set_Solution).
  */
-int
-QAP_Cost_Of_Solution(QAPInfo qi)
+QAPInfo
+QAP_New_Info(QAPInstance inst)
 {
-  int size = qi->size;
-  QAPMatrix mat_A = qi->a;
-  QAPMatrix mat_B = qi->b;
-  QAPVector sol = qi->sol;
-  int i, j;
-  int cost = 0;
+  QAPInfo qi = (QAPInfo) calloc(1, sizeof(*qi));
 
-  for (i = 0; i < size; i++)
-    for (j = 0; j < size; j++)
-      cost += mat_A[i][j] * mat_B[sol[i]][sol[j]];
+  if (qi == NULL)
+    {
+      fprintf(stderr, "%s:%d calloc failed\n", __FILE__, __LINE__);
+      exit(1);
+    }
 
-  return qi->cost = cost;
-}
+  qi->inst = inst;
+  if (inst->a == NULL)		/* header only */
+    return qi;
+
+  qi->sol = QAP_Alloc_Vector(inst->size);
+  qi->delta = QAP_Alloc_Tri_Matrix(inst->size, (inst->cost64) ? sizeof(long long) : sizeof(int));
+  qi->swap_vec = calloc(inst->size, 4 * ((inst->cost64) ? sizeof(long long) : sizeof(int)) +
+			((inst->a_csr != NULL) ? 2 * sizeof(int) : 0));
+  if (qi->swap_vec == NULL)
+    {
+      fprintf(stderr, "%s:%d calloc failed\n", __FILE__, __LINE__);
+      exit(1);
+    }
+  if (inst->permuted_b)
+    {
+      qi->pb = QAP_Alloc_Matrix_Width(inst->size, inst->width);
+      if (inst->bt != NULL)
+	qi->pbt = QAP_Alloc_Matrix_Width(inst->size, inst->width);
+    }
 
+  return qi;
+}
 
-/*
- *  The following functions are strongly inspired from E. Taillard's
- *  Robust Taboo Search code.
- *  http://mistic.heig-vd.ch/taillard/codes.dir/tabou_qap2.c
- */
 
 
 /*
- *  Computes the cost difference if elements i and j are permuted
+ *  Frees a QAPInfo (but not its instance)
  */
-
 void
-QAP_Compute_Delta(QAPInfo qi, int i, int j)
+QAP_Free_Info(QAPInfo qi)
 {
-  int size = qi->size;
-  QAPMatrix mat_A = qi->a;
-  QAPMatrix mat_B = qi->b;
-  QAPVector sol = qi->sol;
-  int pi = sol[i];
-  int pj = sol[j];
-  int k, pk;
-  int d = (mat_A[i][i] - mat_A[j][j]) * (mat_B[pj][pj] - mat_B[pi][pi]) +
-          (mat_A[i][j] - mat_A[j][i]) * (mat_B[pj][pi] - mat_B[pi][pj]);
-
-  for (k = 0; k < size; k++)
+  if (qi->sol != NULL)
     {
-      if (k != i && k != j)
-	{
-	  pk = sol[k];
-	  d += (mat_A[k][i] - mat_A[k][j]) * (mat_B[pk][pj] - mat_B[pk][pi]) +
-	       (mat_A[i][k] - mat_A[j][k]) * (mat_B[pj][pk] - mat_B[pi][pk]);
-	}
+      QAP_Free_Vector(qi->sol);
+      QAP_Free_Tri_Matrix(qi->delta);
+      free(qi->swap_vec);
     }
-
-  qi->delta[i][j] = d;
+  if (qi->pb != NULL)
+    QAP_Free_Matrix(qi->pb);
+  if (qi->pbt != NULL)
+    QAP_Free_Matrix(qi->pbt);
+  if (qi->row_min != NULL)
+    free(qi->row_min);
+  free(qi);
 }
 
 
+
 /*
- *  As Compute_Delta: computes the cost difference if elements i and j are permuted
- *  but the value of delta[i][j] is supposed to be known before
- *  the transposition of elements r and s.
+ *  Load a QAP problem (instance and a solving state)
+ *
+ *  Returns the info structure
  */
-void
-QAP_Compute_Delta_Part(QAPInfo qi, int i, int j, int r, int s)
+QAPInfo
+QAP_Load_Problem(char *file_name, int flags)
 {
-  QAPMatrix mat_A = qi->a;
-  QAPMatrix mat_B = qi->b;
-  QAPVector sol = qi->sol;
-  int pi = sol[i];
-  int pj = sol[j];
-  int pr = sol[r];
-  int ps = sol[s];
-
-  qi->delta[i][j] +=
-    (mat_A[r][i] - mat_A[r][j] + mat_A[s][j] - mat_A[s][i]) *
-    (mat_B[ps][pi] - mat_B[ps][pj] + mat_B[pr][pj] - mat_B[pr][pi]) +
-    (mat_A[i][r] - mat_A[j][r] + mat_A[j][s] - mat_A[i][s]) *
-    (mat_B[pi][ps] - mat_B[pj][ps] + mat_B[pj][pr] - mat_B[pi][pr]);
+  return QAP_New_Info(QAP_Load_Instance(file_name, flags));
 }
 
 
+
 /*
- *  Computes the entire delta matrix
+ *  Delta update kernels
+ *
+ *  After the swap of r and s, for i, j not in {r, s} Compute_Delta_Part
+ *  can be rewritten with 4 vectors only depending on r and s:
+ *
+ *    u[k]  = a[s][k] - a[r][k]          v[k]  = b[p[r]][p[k]] - b[p[s]][p[k]]
+ *    u2[k] = a[k][s] - a[k][r]          v2[k] = b[p[k]][p[r]] - b[p[k]][p[s]]
+ *
+ *    delta[i][j] += (u[j] - u[i]) * (v[j] - v[i]) + (u2[j] - u2[i]) * (v2[j] - v2[i])
+ *
+ *  (symmetric case: u2 = u, v2 = v, i.e. delta[i][j] += 2 * (u[j] - u[i]) * (v[j] - v[i])).
+ *
+ *  A kernel applies this update to a whole (part of) row of delta (no test inside).
+ *  The entries involving r or s are then recomputed entirely.
+ *  With 64-bit costs the vectors, their differences and the products are all
+ *  64-bit (an element difference alone may not fit in 32 bits).
+ *
+ *  A kernel also provides a dot product of differences used by the full delta
+ *  when rows are contiguous (with the permuted distance matrix), one per matrix
+ *  width (narrow elements are widened to 16 bits and multiplied with madd).
+ *  The kernel is chosen at runtime (CPUID) among scalar, AVX2 and AVX-512 versions.
+ *  The scalar version is the original code (also the reference, see USE_ALONE).
  */
 
-void
-QAP_Compute_All_Delta(QAPInfo qi)
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(NO_SIMD)
+#define USE_SIMD_KERNELS
+#include <immintrin.h>
+#endif
+
+typedef void (*UpdateRowGen)(int *d, int n, const int *u, const int *v, const int *u2, const int *v2,
+			     int ui, int vi, int u2i, int v2i);
+
+typedef void (*UpdateRowSym)(int *d, int n, const int *u, const int *v, int ui, int vi);
+
+typedef void (*UpdateRowGen64)(long long *d, int n, const long long *u, const long long *v,
+			       const long long *u2, const long long *v2,
+			       long long ui, long long vi, long long u2i, long long v2i);
+
+typedef void (*UpdateRowSym64)(long long *d, int n, const long long *u, const long long *v,
+			       long long ui, long long vi);
+
+typedef int (*DotDiff)(const int *x1, const int *x2, const int *y1, const int *y2, int n);
+
+typedef int (*DotDiff16)(const short *x1, const short *x2, const short *y1, const short *y2, int n);
+
+typedef int (*DotDiff8)(const unsigned char *x1, const unsigned char *x2,
+			const unsigned char *y1, const unsigned char *y2, int n);
+
+typedef struct
 {
-  int size = qi->size;
-  int i, j;
+  char *name;
+  UpdateRowGen update_row_gen;	/* NULL for the scalar kernel */
+  UpdateRowSym update_row_sym;
+  UpdateRowGen64 update_row_gen64; /* same with 64-bit costs */
+  UpdateRowSym64 update_row_sym64;
+  DotDiff dot_diff;		/* sum of (x1[k] - x2[k]) * (y1[k] - y2[k]) (NULL: scalar loop) */
+  DotDiff16 dot_diff16;
+  DotDiff8 dot_diff8;
+} DeltaKernel;
+
+
+#ifdef USE_SIMD_KERNELS
+
+__attribute__((target("avx2")))
+static void
+Update_Row_Gen_AVX2(int *d, int n, const int *u, const int *v, const int *u2, const int *v2,
+		    int ui, int vi, int u2i, int v2i)
+{
+  __m256i x_ui = _mm256_set1_epi32(ui), x_vi = _mm256_set1_epi32(vi);
+  __m256i x_u2i = _mm256_set1_epi32(u2i), x_v2i = _mm256_set1_epi32(v2i);
+  int j;
 
-  for (i = 0; i < size; i++)
+  for (j = 0; j + 8 <= n; j += 8)
     {
-      qi->delta[i][i] = 0;	/* useless (delta is a strictly upper triangular matrix)  */
-      for (j = i + 1; j < size; j++)
-	QAP_Compute_Delta(qi, i, j);
+      __m256i x_u = _mm256_sub_epi32(_mm256_loadu_si256((__m256i *) (u + j)), x_ui);
+      __m256i x_v = _mm256_sub_epi32(_mm256_loadu_si256((__m256i *) (v + j)), x_vi);
+      __m256i x_u2 = _mm256_sub_epi32(_mm256_loadu_si256((__m256i *) (u2 + j)), x_u2i);
+      __m256i x_v2 = _mm256_sub_epi32(_mm256_loadu_si256((__m256i *) (v2 + j)), x_v2i);
+      __m256i x_d = _mm256_loadu_si256((__m256i *) (d + j));
+
+      x_d = _mm256_add_epi32(x_d, _mm256_add_epi32(_mm256_mullo_epi32(x_u, x_v), _mm256_mullo_epi32(x_u2, x_v2)));
+      _mm256_storeu_si256((__m256i *) (d + j), x_d);
     }
+
+  for (; j < n; j++)
+    d[j] += (u[j] - ui) * (v[j] - vi) + (u2[j] - u2i) * (v2[j] - v2i);
 }
 
 
-int
-QAP_Get_Delta(QAPInfo qi, int i, int j)
+__attribute__((target("avx2")))
+static void
+Update_Row_Sym_AVX2(int *d, int n, const int *u, const int *v, int ui, int vi)
 {
-  return (i <= j) ? qi->delta[i][j] : qi->delta[j][i];
-}
+  __m256i x_ui = _mm256_set1_epi32(ui), x_vi = _mm256_set1_epi32(vi);
+  int j;
 
+  for (j = 0; j + 8 <= n; j += 8)
+    {
+      __m256i x_u = _mm256_sub_epi32(_mm256_loadu_si256((__m256i *) (u + j)), x_ui);
+      __m256i x_v = _mm256_sub_epi32(_mm256_loadu_si256((__m256i *) (v + j)), x_vi);
+      __m256i x_p = _mm256_mullo_epi32(x_u, x_v);
+      __m256i x_d = _mm256_loadu_si256((__m256i *) (d + j));
+
+      x_d = _mm256_add_epi32(x_d, _mm256_add_epi32(x_p, x_p));
+      _mm256_storeu_si256((__m256i *) (d + j), x_d);
+    }
+
+  for (; j < n; j++)
+    d[j] += 2 * (u[j] - ui) * (v[j] - vi);
+}
+
+
+__attribute__((target("avx512f")))
+static void
+Update_Row_Gen_AVX512(int *d, int n, const int *u, const int *v, const int *u2, const int *v2,
+		      int ui, int vi, int u2i, int v2i)
+{
+  __m512i x_ui = _mm512_set1_epi32(ui), x_vi = _mm512_set1_epi32(vi);
+  __m512i x_u2i = _mm512_set1_epi32(u2i), x_v2i = _mm512_set1_epi32(v2i);
+  int j;
+
+  for (j = 0; j < n; j += 16)
+    {
+      __mmask16 m = (n - j >= 16) ? 0xFFFF : (__mmask16) ((1U << (n - j)) - 1);
+      __m512i x_u = _mm512_sub_epi32(_mm512_maskz_loadu_epi32(m, u + j), x_ui);
+      __m512i x_v = _mm512_sub_epi32(_mm512_maskz_loadu_epi32(m, v + j), x_vi);
+      __m512i x_u2 = _mm512_sub_epi32(_mm512_maskz_loadu_epi32(m, u2 + j), x_u2i);
+      __m512i x_v2 = _mm512_sub_epi32(_mm512_maskz_loadu_epi32(m, v2 + j), x_v2i);
+      __m512i x_d = _mm512_maskz_loadu_epi32(m, d + j);
+
+      x_d = _mm512_add_epi32(x_d, _mm512_add_epi32(_mm512_mullo_epi32(x_u, x_v), _mm512_mullo_epi32(x_u2, x_v2)));
+      _mm512_mask_storeu_epi32(d + j, m, x_d);
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static void
+Update_Row_Sym_AVX512(int *d, int n, const int *u, const int *v, int ui, int vi)
+{
+  __m512i x_ui = _mm512_set1_epi32(ui), x_vi = _mm512_set1_epi32(vi);
+  int j;
+
+  for (j = 0; j < n; j += 16)
+    {
+      __mmask16 m = (n - j >= 16) ? 0xFFFF : (__mmask16) ((1U << (n - j)) - 1);
+      __m512i x_u = _mm512_sub_epi32(_mm512_maskz_loadu_epi32(m, u + j), x_ui);
+      __m512i x_v = _mm512_sub_epi32(_mm512_maskz_loadu_epi32(m, v + j), x_vi);
+      __m512i x_p = _mm512_mullo_epi32(x_u, x_v);
+      __m512i x_d = _mm512_maskz_loadu_epi32(m, d + j);
+
+      x_d = _mm512_add_epi32(x_d, _mm512_add_epi32(x_p, x_p));
+      _mm512_mask_storeu_epi32(d + j, m, x_d);
+    }
+}
 
 
 /*
- *  Return the cost if i1 and i1 would be swapped
+ *  64-bit costs: u, v, u2, v2 are 64-bit vectors (their differences may not
+ *  fit in 32 bits) and AVX2 has no 64-bit multiply: it is done with 3 mul_epu32
+ *  (the high x high product only affects bits above 64).
+ *  Also used by the AVX-512 kernel.
+ */
+__attribute__((target("avx2")))
+static inline __m256i
+Mullo_Epi64_AVX2(__m256i x, __m256i y)
+{
+  __m256i x_lo_lo = _mm256_mul_epu32(x, y);
+  __m256i x_cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), y),
+				     _mm256_mul_epu32(x, _mm256_srli_epi64(y, 32)));
+
+  return _mm256_add_epi64(x_lo_lo, _mm256_slli_epi64(x_cross, 32));
+}
+
+
+__attribute__((target("avx2")))
+static void
+Update_Row_Gen64_AVX2(long long *d, int n, const long long *u, const long long *v,
+		      const long long *u2, const long long *v2,
+		      long long ui, long long vi, long long u2i, long long v2i)
+{
+  __m256i x_ui = _mm256_set1_epi64x(ui), x_vi = _mm256_set1_epi64x(vi);
+  __m256i x_u2i = _mm256_set1_epi64x(u2i), x_v2i = _mm256_set1_epi64x(v2i);
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    {
+      __m256i x_u = _mm256_sub_epi64(_mm256_loadu_si256((__m256i *) (u + j)), x_ui);
+      __m256i x_v = _mm256_sub_epi64(_mm256_loadu_si256((__m256i *) (v + j)), x_vi);
+      __m256i x_u2 = _mm256_sub_epi64(_mm256_loadu_si256((__m256i *) (u2 + j)), x_u2i);
+      __m256i x_v2 = _mm256_sub_epi64(_mm256_loadu_si256((__m256i *) (v2 + j)), x_v2i);
+      __m256i x_d = _mm256_loadu_si256((__m256i *) (d + j));
+
+      x_d = _mm256_add_epi64(x_d, _mm256_add_epi64(Mullo_Epi64_AVX2(x_u, x_v), Mullo_Epi64_AVX2(x_u2, x_v2)));
+      _mm256_storeu_si256((__m256i *) (d + j), x_d);
+    }
+
+  for (; j < n; j++)
+    d[j] += (u[j] - ui) * (v[j] - vi) + (u2[j] - u2i) * (v2[j] - v2i);
+}
+
+
+__attribute__((target("avx2")))
+static void
+Update_Row_Sym64_AVX2(long long *d, int n, const long long *u, const long long *v, long long ui, long long vi)
+{
+  __m256i x_ui = _mm256_set1_epi64x(ui), x_vi = _mm256_set1_epi64x(vi);
+  int j;
+
+  for (j = 0; j + 4 <= n; j += 4)
+    {
+      __m256i x_u = _mm256_sub_epi64(_mm256_loadu_si256((__m256i *) (u + j)), x_ui);
+      __m256i x_v = _mm256_sub_epi64(_mm256_loadu_si256((__m256i *) (v + j)), x_vi);
+      __m256i x_p = Mullo_Epi64_AVX2(x_u, x_v);
+      __m256i x_d = _mm256_loadu_si256((__m256i *) (d + j));
+
+      x_d = _mm256_add_epi64(x_d, _mm256_add_epi64(x_p, x_p));
+      _mm256_storeu_si256((__m256i *) (d + j), x_d);
+    }
+
+  for (; j < n; j++)
+    d[j] += 2 * (u[j] - ui) * (v[j] - vi);
+}
+
+
+__attribute__((target("avx2")))
+static inline int
+Horizontal_Sum_AVX2(__m256i x_sum)
+{
+  __m128i x_sum4 = _mm_add_epi32(_mm256_castsi256_si128(x_sum), _mm256_extracti128_si256(x_sum, 1));
+
+  x_sum4 = _mm_add_epi32(x_sum4, _mm_shuffle_epi32(x_sum4, 0x4E));
+  x_sum4 = _mm_add_epi32(x_sum4, _mm_shuffle_epi32(x_sum4, 0xB1));
+  return _mm_cvtsi128_si32(x_sum4);
+}
+
+
+__attribute__((target("avx2")))
+static int
+Dot_Diff_AVX2(const int *x1, const int *x2, const int *y1, const int *y2, int n)
+{
+  __m256i x_sum = _mm256_setzero_si256();
+  int j, d;
+
+  for (j = 0; j + 8 <= n; j += 8)
+    {
+      __m256i x_x = _mm256_sub_epi32(_mm256_loadu_si256((__m256i *) (x1 + j)), _mm256_loadu_si256((__m256i *) (x2 + j)));
+      __m256i x_y = _mm256_sub_epi32(_mm256_loadu_si256((__m256i *) (y1 + j)), _mm256_loadu_si256((__m256i *) (y2 + j)));
+
+      x_sum = _mm256_add_epi32(x_sum, _mm256_mullo_epi32(x_x, x_y));
+    }
+
+  d = Horizontal_Sum_AVX2(x_sum);
+
+  for (; j < n; j++)
+    d += (x1[j] - x2[j]) * (y1[j] - y2[j]);
+
+  return d;
+}
+
+
+__attribute__((target("avx512f")))
+static int
+Dot_Diff_AVX512(const int *x1, const int *x2, const int *y1, const int *y2, int n)
+{
+  __m512i x_sum = _mm512_setzero_si512();
+  int j;
+
+  for (j = 0; j < n; j += 16)
+    {
+      __mmask16 m = (n - j >= 16) ? 0xFFFF : (__mmask16) ((1U << (n - j)) - 1);
+      __m512i x_x = _mm512_sub_epi32(_mm512_maskz_loadu_epi32(m, x1 + j), _mm512_maskz_loadu_epi32(m, x2 + j));
+      __m512i x_y = _mm512_sub_epi32(_mm512_maskz_loadu_epi32(m, y1 + j), _mm512_maskz_loadu_epi32(m, y2 + j));
+
+      x_sum = _mm512_add_epi32(x_sum, _mm512_mullo_epi32(x_x, x_y));
+    }
+
+  return _mm512_reduce_add_epi32(x_sum);
+}
+
+
+/*
+ *  16-bit elements: the differences fit in a short (see QAP_Narrowest_Width)
+ *  so madd_epi16 computes x * y and adds pairs in 32 bits.
+ *  Also used by the AVX-512 kernel (avx512f has no 16-bit multiply).
+ */
+__attribute__((target("avx2")))
+static int
+Dot_Diff16_AVX2(const short *x1, const short *x2, const short *y1, const short *y2, int n)
+{
+  __m256i x_sum = _mm256_setzero_si256();
+  int j, d;
+
+  for (j = 0; j + 16 <= n; j += 16)
+    {
+      __m256i x_x = _mm256_sub_epi16(_mm256_loadu_si256((__m256i *) (x1 + j)), _mm256_loadu_si256((__m256i *) (x2 + j)));
+      __m256i x_y = _mm256_sub_epi16(_mm256_loadu_si256((__m256i *) (y1 + j)), _mm256_loadu_si256((__m256i *) (y2 + j)));
+
+      x_sum = _mm256_add_epi32(x_sum, _mm256_madd_epi16(x_x, x_y));
+    }
+
+  d = Horizontal_Sum_AVX2(x_sum);
+
+  for (; j < n; j++)
+    d += (x1[j] - x2[j]) * (y1[j] - y2[j]);
+
+  return d;
+}
+
+
+/*
+ *  8-bit elements: zero-extended to 16 bits, then as Dot_Diff16_AVX2
+ */
+__attribute__((target("avx2")))
+static int
+Dot_Diff8_AVX2(const unsigned char *x1, const unsigned char *x2,
+	       const unsigned char *y1, const unsigned char *y2, int n)
+{
+  __m256i x_sum = _mm256_setzero_si256();
+  int j, d;
+
+  for (j = 0; j + 16 <= n; j += 16)
+    {
+      __m256i x_x = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (x1 + j))),
+				     _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (x2 + j))));
+      __m256i x_y = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (y1 + j))),
+				     _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (y2 + j))));
+
+      x_sum = _mm256_add_epi32(x_sum, _mm256_madd_epi16(x_x, x_y));
+    }
+
+  d = Horizontal_Sum_AVX2(x_sum);
+
+  for (; j < n; j++)
+    d += (x1[j] - x2[j]) * (y1[j] - y2[j]);
+
+  return d;
+}
+
+#endif /* USE_SIMD_KERNELS */
+
+
+static const DeltaKernel kernel_tbl[] = {
+  [QAP_KERNEL_SCALAR] = { "scalar", NULL, NULL, NULL, NULL, NULL, NULL, NULL },
+#ifdef USE_SIMD_KERNELS
+  [QAP_KERNEL_AVX2]   = { "avx2",   Update_Row_Gen_AVX2,   Update_Row_Sym_AVX2,
+			  Update_Row_Gen64_AVX2, Update_Row_Sym64_AVX2,
+			  Dot_Diff_AVX2,   Dot_Diff16_AVX2, Dot_Diff8_AVX2 },
+  [QAP_KERNEL_AVX512] = { "avx512", Update_Row_Gen_AVX512, Update_Row_Sym_AVX512,
+			  Update_Row_Gen64_AVX2, Update_Row_Sym64_AVX2,
+			  Dot_Diff_AVX512, Dot_Diff16_AVX2, Dot_Diff8_AVX2 },
+#endif
+};
+
+static const DeltaKernel *kernel = NULL; /* NULL: not yet selected */
+
+
+/*
+ *  Returns 1 if the kernel can be used on this machine
+ */
+int
+QAP_Is_Kernel_Supported(int kernel_no)
+{
+  switch(kernel_no)
+    {
+    case QAP_KERNEL_SCALAR:
+      return 1;
+
+#ifdef USE_SIMD_KERNELS
+    case QAP_KERNEL_AVX2:
+      return __builtin_cpu_supports("avx2");
+
+    case QAP_KERNEL_AVX512:
+      return __builtin_cpu_supports("avx512f");
+#endif
+    }
+
+  return 0;
+}
+
+
+/*
+ *  Selects the delta update kernel (QAP_KERNEL_XXX or -1 for the best supported one)
+ *  Returns the selected kernel (it is the scalar one if kernel_no is not supported)
  */
 int
+QAP_Select_Kernel(int kernel_no)
+{
+  if (kernel_no < 0)
+    for (kernel_no = QAP_KERNEL_AVX512; !QAP_Is_Kernel_Supported(kernel_no); kernel_no--)
+      ;
+  else if (!QAP_Is_Kernel_Supported(kernel_no))
+    kernel_no = QAP_KERNEL_SCALAR;
+
+  kernel = kernel_tbl + kernel_no;
+
+  return kernel_no;
+}
+
+
+/*
+ *  Returns the name of the selected kernel
+ */
+char *
+QAP_Get_Kernel_Name(void)
+{
+  if (kernel == NULL)
+    QAP_Select_Kernel(-1);
+
+  return kernel->name;
+}
+
+
+/*
+ *  Returns the kernel number associated to a name (or -1 if unknown)
+ */
+int
+QAP_Find_Kernel(char *name)
+{
+  int kernel_no;
+
+  for (kernel_no = 0; kernel_no < (int) (sizeof(kernel_tbl) / sizeof(kernel_tbl[0])); kernel_no++)
+    if (kernel_tbl[kernel_no].name != NULL && strcmp(name, kernel_tbl[kernel_no].name) == 0)
+      return kernel_no;
+
+  return -1;
+}
+
+
+/*
+ *  Thread pool used by QAP_Compute_All_Delta
+ *
+ *  The pool is started at its first use. A job is a set of independent tasks
+ *  (numbered from 0) taken in increasing order by the pool threads and by the
+ *  calling thread. Only one job runs at a time: if the pool is busy (e.g.
+ *  several solver threads), the tasks are run by the calling thread.
+ */
+
+static int nb_pool_threads = 0;	/* #threads including the caller (0: #cpus) */
+static pthread_t *pool_thread = NULL;	/* NULL: not yet started */
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done_cond = PTHREAD_COND_INITIALIZER;
+static unsigned pool_job_no = 0;	/* incremented for each new job */
+static int pool_nb_running;	/* #pool threads still working on the current job */
+static int pool_busy = 0;	/* is a job running ? (atomic) */
+static void (*pool_fct)(void *arg, int task_no);
+static void *pool_arg;
+static int pool_nb_tasks;
+static int pool_next_task;	/* next task to run (atomic) */
+
+
+/*
+ *  Sets the number of threads used by QAP_Compute_All_Delta (0: #cpus)
+ *  Must be called before the first computation.
+ */
+void
+QAP_Set_Delta_Threads(int nb_threads)
+{
+  nb_pool_threads = nb_threads;
+}
+
+
+/*
+ *  Returns the number of threads used by QAP_Compute_All_Delta
+ */
+int
+QAP_Get_Delta_Threads(void)
+{
+  if (nb_pool_threads <= 0)
+    nb_pool_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (nb_pool_threads <= 0)
+    nb_pool_threads = 1;
+
+  return nb_pool_threads;
+}
+
+
+static void
+Pool_Run_Tasks(void)
+{
+  int task_no;
+
+  while ((task_no = __atomic_fetch_add(&pool_next_task, 1, __ATOMIC_RELAXED)) < pool_nb_tasks)
+    (*pool_fct)(pool_arg, task_no);
+}
+
+
+static void *
+Pool_Thread(void *unused)
+{
+  unsigned job_no = 0;
+
+  pthread_mutex_lock(&pool_mutex);
+  for (;;)
+    {
+      while (pool_job_no == job_no)
+	pthread_cond_wait(&pool_start_cond, &pool_mutex);
+      job_no = pool_job_no;
+      pthread_mutex_unlock(&pool_mutex);
+
+      Pool_Run_Tasks();
+
+      pthread_mutex_lock(&pool_mutex);
+      if (--pool_nb_running == 0)
+	pthread_cond_signal(&pool_done_cond);
+    }
+
+  return NULL;
+}
+
+
+static void
+Thread_Pool_Run(void (*fct)(void *arg, int task_no), void *arg, int nb_tasks)
+{
+  int i;
+
+  if (nb_tasks <= 1 || QAP_Get_Delta_Threads() <= 1 || __atomic_exchange_n(&pool_busy, 1, __ATOMIC_ACQUIRE))
+    {
+      for (i = 0; i < nb_tasks; i++)
+	(*fct)(arg, i);
+      return;
+    }
+
+  pthread_mutex_lock(&pool_mutex);
+  if (pool_thread == NULL)
+    {
+      pool_thread = malloc(nb_pool_threads * sizeof(pthread_t));
+      for (i = 1; i < nb_pool_threads; i++)
+	if (pool_thread == NULL || pthread_create(&pool_thread[i], NULL, Pool_Thread, NULL) != 0)
+	  {
+	    fprintf(stderr, "%s:%d cannot create the thread pool\n", __FILE__, __LINE__);
+	    exit(1);
+	  }
+    }
+
+  pool_fct = fct;
+  pool_arg = arg;
+  pool_nb_tasks = nb_tasks;
+  pool_next_task = 0;
+  pool_nb_running = nb_pool_threads - 1;
+  pool_job_no++;
+  pthread_cond_broadcast(&pool_start_cond);
+  pthread_mutex_unlock(&pool_mutex);
+
+  Pool_Run_Tasks();
+
+  pthread_mutex_lock(&pool_mutex);
+  while (pool_nb_running > 0)
+    pthread_cond_wait(&pool_done_cond, &pool_mutex);
+  pthread_mutex_unlock(&pool_mutex);
+
+  __atomic_store_n(&pool_busy, 0, __ATOMIC_RELEASE);
+}
+
+
+
+
+/*
+ *  The following functions are strongly inspired from E. Taillard's
+ *  Robust Taboo Search code.
+ *  http://mistic.heig-vd.ch/taillard/codes.dir/tabou_qap2.c
+ *
+ *  Matrices are accessed through their data block and stride (kept in
+ *  local variables since stores in delta could alias the stride field).
+ *
+ *  For symmetric instances (a and b symmetric) the (k,i) and (i,k) halves
+ *  of the general formulas are equal (and a[i][j] - a[j][i] = 0) so only
+ *  one half is computed and doubled, as in Taillard's RoTS for symmetric
+ *  instances. Columns are then read as rows (a[k][i] = a[i][k]).
+ *
+ *  If the permuted distance matrix is used, it must be in sync with the solution
+ *  (it is the case after QAP_Set_Solution and QAP_Do_Swap).
+ *
+ *  The cost and delta engine reads the kernel matrices (ka, kb, at, bt, pb, pbt)
+ *  whose elements are stored on 1, 2 or sizeof(int) bytes (see QAP_Load_Problem).
+ *  It is thus specialized for each width (see qap-delta-engine.h).
+ */
+
+#define DELTA_TASK_ROWS      8	/* #rows of delta computed by a task of QAP_Compute_All_Delta */
+#define DELTA_TILE_COLS     32	/* #columns of a tile (the rows j of a tile stay in cache) */
+#define DELTA_MIN_PAR_SIZE 128	/* min size to use the thread pool */
+
+
+/*
+ *  Takes into account the delta d of swapping i and j for the min of row i (rm)
+ *  The ties are broken at random: the element j of each tie has the same probability.
+ */
+static inline void
+Row_Min_Add(QAPRowMin *rm, int j, QAPCost d, unsigned (*random)(unsigned n))
+{
+  if (d < rm->min)
+    {
+      rm->min = d;
+      rm->arg = j;
+      rm->nb_ties = 1;
+    }
+  else if (d == rm->min && (*random)(++rm->nb_ties) == 0)
+    rm->arg = j;
+}
+
+
+/*
+ *  Empties the minima of all the rows (before a scan of delta)
+ */
+static void
+Row_Min_Reset(QAPInfo qi)
+{
+  int i;
+
+  for (i = 0; i < qi->inst->size; i++)
+    {
+      qi->row_min[i].min = QAP_COST_MAX;
+      qi->row_min[i].arg = 0;
+      qi->row_min[i].nb_ties = 0;
+    }
+}
+
+typedef struct qap_engine
+{
+  char *name;
+  QAPCost (*cost_of_solution)(QAPInfo qi);
+  void (*store_delta)(QAPInfo qi, int i, int j);
+  void (*add_delta_part)(QAPInfo qi, int i, int j, int r, int s);
+  void (*compute_all_delta)(QAPInfo qi);
+  void (*executed_swap)(QAPInfo qi, int i1, int i2);
+  void (*set_solution)(QAPInfo qi);
+  void (*row_minima)(QAPInfo qi);
+} DeltaEngine;
+
+
+#define CONCAT(x, y)       CONCAT1(x, y)
+#define CONCAT1(x, y)      x ## y
+#define FCT(f)             CONCAT(f, SUFFIX)
+
+				/* --- int costs --- */
+#define COST               int
+#define DELTA_DATA         data
+#define UPDATE_ROW_GEN     update_row_gen
+#define UPDATE_ROW_SYM     update_row_sym
+#define UPDATE_ROW_GEN_T   UpdateRowGen
+#define UPDATE_ROW_SYM_T   UpdateRowSym
+
+#define ELEM               unsigned char
+#define DATA               data8
+#define DOT_DIFF           dot_diff8
+#define SUFFIX             _8
+#include "qap-delta-engine.h"
+#undef ELEM
+#undef DATA
+#undef DOT_DIFF
+#undef SUFFIX
+
+#define ELEM               short
+#define DATA               data16
+#define DOT_DIFF           dot_diff16
+#define SUFFIX             _16
+#include "qap-delta-engine.h"
+#undef ELEM
+#undef DATA
+#undef DOT_DIFF
+#undef SUFFIX
+
+#define ELEM               int
+#define DATA               data
+#define DOT_DIFF           dot_diff
+#define SUFFIX             _32
+#include "qap-delta-engine.h"
+#undef ELEM
+#undef DATA
+#undef DOT_DIFF
+#undef SUFFIX
+
+#undef COST
+#undef DELTA_DATA
+#undef UPDATE_ROW_GEN
+#undef UPDATE_ROW_SYM
+#undef UPDATE_ROW_GEN_T
+#undef UPDATE_ROW_SYM_T
+
+				/* --- 64-bit costs (the int dot kernels could overflow) --- */
+#define COST               long long
+#define DELTA_DATA         data64
+#define UPDATE_ROW_GEN     update_row_gen64
+#define UPDATE_ROW_SYM     update_row_sym64
+#define UPDATE_ROW_GEN_T   UpdateRowGen64
+#define UPDATE_ROW_SYM_T   UpdateRowSym64
+
+#define ELEM               unsigned char
+#define DATA               data8
+#define SUFFIX             _8_64
+#include "qap-delta-engine.h"
+#undef ELEM
+#undef DATA
+#undef SUFFIX
+
+#define ELEM               short
+#define DATA               data16
+#define SUFFIX             _16_64
+#include "qap-delta-engine.h"
+#undef ELEM
+#undef DATA
+#undef SUFFIX
+
+#define ELEM               int
+#define DATA               data
+#define SUFFIX             _32_64
+#include "qap-delta-engine.h"
+#undef ELEM
+#undef DATA
+#undef SUFFIX
+
+#undef COST
+#undef DELTA_DATA
+#undef UPDATE_ROW_GEN
+#undef UPDATE_ROW_SYM
+#undef UPDATE_ROW_GEN_T
+#undef UPDATE_ROW_SYM_T
+
+
+#define ENGINE(name, suffix)					\
+  { name, Cost_Of_Solution##suffix, Store_Delta##suffix,	\
+    Add_Delta_Part##suffix, Compute_All_Delta##suffix,		\
+    Executed_Swap##suffix, Set_Solution##suffix, Row_Minima##suffix }
+
+static const DeltaEngine engine_tbl[2][3] = {
+  { ENGINE("uint8", _8),    ENGINE("int16", _16),    ENGINE("int32", _32)    },
+  { ENGINE("uint8", _8_64), ENGINE("int16", _16_64), ENGINE("int32", _32_64) },
+};
+
+
+/*
+ *  Selects the engine associated to the width of the kernel matrices and of the costs
+ */
+static void
+Select_Engine(QAPInstance inst)
+{
+  int width_no = (inst->width == 1) ? 0 : (inst->width == 2) ? 1 : 2;
+
+  inst->engine = &engine_tbl[inst->cost64][width_no];
+}
+
+
+/*
+ *  Returns the name of the width of the kernel matrices
+ */
+char *
+QAP_Get_Width_Name(QAPInfo qi)
+{
+  return qi->inst->engine->name;
+}
+
+
+/*
+ *  Computes the cost of a solution
+ *  (symmetric case: only the upper triangle is visited)
+ */
+QAPCost
+QAP_Cost_Of_Solution(QAPInfo qi)
+{
+  return qi->cost = (*qi->inst->engine->cost_of_solution)(qi);
+}
+
+
+void
+QAP_Compute_Delta(QAPInfo qi, int i, int j)
+{
+  (*qi->inst->engine->store_delta)(qi, i, j);
+}
+
+
+void
+QAP_Compute_Delta_Part(QAPInfo qi, int i, int j, int r, int s)
+{
+  (*qi->inst->engine->add_delta_part)(qi, i, j, r, s);
+}
+
+
+/*
+ *  Computes the entire delta matrix
+ */
+
+void
+QAP_Compute_All_Delta(QAPInfo qi)
+{
+  if (kernel == NULL)
+    QAP_Select_Kernel(-1);
+
+  (*qi->inst->engine->compute_all_delta)(qi);
+}
+
+
+QAPCost
+QAP_Get_Delta(QAPInfo qi, int i, int j)
+{
+  if (i == j)
+    return 0;
+
+  size_t k = (i < j) ? QAP_Delta_Index(qi, i, j) : QAP_Delta_Index(qi, j, i);
+
+  return QAP_Delta_At(qi, k);
+}
+
+
+
+/*
+ *  Return the cost if i1 and i1 would be swapped
+ */
+QAPCost
 QAP_Cost_If_Swap(QAPInfo qi, int i, int j)
 {
   return qi->cost + QAP_Get_Delta(qi, i, j);
@@ -376,7 +1521,7 @@ QAP_Cost_If_Swap(QAPInfo qi, int i, int j)
 
 
 
-int
+QAPCost
 QAP_Do_Swap(QAPInfo qi, int i, int j)
 {
   qi->cost = QAP_Cost_If_Swap(qi, i, j);
@@ -397,24 +1542,125 @@ QAP_Do_Swap(QAPInfo qi, int i, int j)
 void
 QAP_Executed_Swap(QAPInfo qi, int i1, int i2)
 {
-  int size = qi->size;
-  int i, j;
+  if (kernel == NULL)
+    QAP_Select_Kernel(-1);
 
-  for (i = 0; i < size; i++)
-    for (j = i + 1; j < size; j++)
-      if (i != i1 && i != i2 && j != i1 && j != i2)
-	QAP_Compute_Delta_Part(qi, i, j, i1, i2);
-      else
-	QAP_Compute_Delta(qi, i, j);
+  (*qi->inst->engine->executed_swap)(qi, i1, i2);
 }
 
 
 void
 QAP_Set_Solution(QAPInfo qi)
 {
-  QAP_Cost_Of_Solution(qi);
+  if (kernel == NULL)
+    QAP_Select_Kernel(-1);
 
-  QAP_Compute_All_Delta(qi);
+  (*qi->inst->engine->set_solution)(qi);
 }
 
 
+/*
+ *  Starts (random != NULL) or stops (random == NULL) maintaining the min of
+ *  each row of delta (with the other element of the swap, see QAPRowMin).
+ *  The delta must be up to date (the minima are computed at once). Then they
+ *  are maintained by QAP_Set_Solution, QAP_Compute_All_Delta and QAP_Do_Swap
+ *  (as a by-product of the update of delta, each row is scanned once updated).
+ *  Ties are broken with random(n) (in [0, n)): the rows are scanned in
+ *  increasing order, and the elements of a row (i, j) in increasing order of j.
+ */
+void
+QAP_Track_Row_Minima(QAPInfo qi, unsigned (*random)(unsigned n))
+{
+  if (random == NULL)
+    {
+      free(qi->row_min);
+      qi->row_min = NULL;
+      qi->row_min_random = NULL;
+      return;
+    }
+
+  if (qi->row_min == NULL)
+    {
+      qi->row_min = (QAPRowMin *) malloc(qi->inst->size * sizeof(QAPRowMin));
+      if (qi->row_min == NULL)
+	{
+	  fprintf(stderr, "%s:%d malloc failed\n", __FILE__, __LINE__);
+	  exit(1);
+	}
+    }
+  qi->row_min_random = random;
+
+  (*qi->inst->engine->row_minima)(qi);
+}
+
+
+
+
+#ifdef USE_ALONE
+
+/*
+ *  Checks the delta update kernels (and the narrow engine if the instance
+ *  allows one) against the scalar one on int matrices
+ *
+ *  compile with: make tools.o; gcc -O2 -pthread -DUSE_ALONE -o check-kernels qap-utils.c tools.o
+ *  execute with: ./check-kernels FILE [NB_SWAPS [SEED]]
+ */
+
+#include "tools.h"
+
+int
+main(int argc, char *argv[])
+{
+  QAPInfo qi, qi_ref;
+  int nb_swaps = (argc > 2) ? atoi(argv[2]) : 1000;
+  int seed = (argc > 3) ? atoi(argv[3]) : 0;
+  int kernel_no, iter, i, j;
+  int nb_err = 0;
+
+  if (argc < 2)
+    {
+      printf("Usage %s FILE [NB_SWAPS [SEED]]\n", argv[0]);
+      return 1;
+    }
+
+  qi = QAP_Load_Problem(argv[1], 0);
+  qi_ref = QAP_Load_Problem(argv[1], QAP_LOAD_NO_NARROW);
+
+  for (kernel_no = QAP_KERNEL_SCALAR; kernel_no <= QAP_KERNEL_AVX512; kernel_no++)
+    {
+      if (!QAP_Is_Kernel_Supported(kernel_no))
+	continue;
+
+      Randomize_Seed(seed);
+      Random_Permut(qi->sol, qi->inst->size, NULL, 0);
+      QAP_Copy_Vector(qi_ref->sol, qi->sol, qi->inst->size);
+      QAP_Set_Solution(qi);
+      QAP_Set_Solution(qi_ref);
+
+      for (iter = 0; iter < nb_swaps; iter++)
+	{
+	  int r = Random(qi->inst->size);
+	  int s = Random(qi->inst->size);
+
+	  if (r == s)
+	    continue;
+
+	  QAP_Select_Kernel(kernel_no);
+	  QAP_Do_Swap(qi, r, s);
+	  QAP_Select_Kernel(QAP_KERNEL_SCALAR);
+	  QAP_Do_Swap(qi_ref, r, s);
+
+	  for (i = 0; i < qi->inst->size; i++)
+	    for (j = i + 1; j < qi->inst->size; j++)
+	      if (QAP_Get_Delta(qi, i, j) != QAP_Get_Delta(qi_ref, i, j) && nb_err++ < 10)
+		printf("%s: iter %d delta[%d][%d] = %lld != %lld\n", kernel_tbl[kernel_no].name, iter, i, j,
+		       QAP_Get_Delta(qi, i, j), QAP_Get_Delta(qi_ref, i, j));
+	}
+
+      printf("kernel %-8s %-6s %s\n", kernel_tbl[kernel_no].name, QAP_Get_Width_Name(qi), (nb_err) ? "ERROR" : "OK");
+    }
+
+  return nb_err != 0;
+}
+
+#endif /* USE_ALONE */
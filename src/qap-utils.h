@@ -10,32 +10,137 @@
 #define _QAP_UTILS_H
 
 #include <string.h>		/* for memcpy */
+#include <limits.h>
 
 typedef int *QAPVector;
-typedef int **QAPMatrix;
 
-typedef struct qap_info
+typedef long long QAPCost;	/* costs and deltas (the engine may use int, see cost64) */
+
+#define QAP_COST_MAX  LLONG_MAX
+
+typedef struct
+{
+  int size;			/* #rows (and #columns) */
+  int stride;			/* #elements between 2 consecutive rows (padded) */
+  int elem_size;		/* size of an element: sizeof(int) except for narrow matrices */
+  union				/* a single cache-line-aligned block of size * stride elements */
+  {
+    int *data;
+    long long *data64;		/* if elem_size == 8 (delta with 64-bit costs) */
+    short *data16;		/* if elem_size == 2 */
+    unsigned char *data8;	/* if elem_size == 1 */
+  };
+} *QAPMatrix;
+
+
+typedef struct
+{
+  int size;			/* #rows (and #columns) */
+  int nnz;			/* #nonzero elements */
+  int *row_start;		/* the nonzeros of row i are in [row_start[i], row_start[i + 1]) */
+  int *col;			/* column of each nonzero */
+  int *val;			/* value of each nonzero */
+} *QAPSparseMatrix;		/* compressed sparse row (CSR) form */
+
+
+typedef struct
+{
+  int size;			/* #rows (and #columns) */
+  int elem_size;		/* sizeof(int) or sizeof(long long) (64-bit costs) */
+  size_t *row_off;		/* element (i, j) with i < j is at data[row_off[i] + j] */
+  union				/* a single cache-line-aligned block of 1 + size * (size - 1) / 2 elements */
+  {
+    int *data;
+    long long *data64;		/* if elem_size == 8 */
+  };
+} *QAPTriMatrix;		/* packed strictly upper triangular matrix (row i + 1 follows row i) */
+
+
+#define QAP_CACHE_LINE_SIZE  64	/* in bytes (alignment and row padding of matrices) */
+
+#define QAP_Row(mat, i)      ((mat)->data + (size_t) (i) * (mat)->stride) /* int matrices only */
+
+#define QAP_Elem(mat, i, j)  (QAP_Row(mat, i)[j])
+
+				/* direct access to qi->delta: (i, j) with i < j is at index QAP_Delta_Index(qi, i, j) */
+				/* the index of (i, j + 1) is the next one, and (i + 1, i + 2) follows (i, size - 1) */
+#define QAP_Delta_Index(qi, i, j)  ((qi)->delta->row_off[i] + (j))
+
+#define QAP_Delta_At(qi, k)  (((qi)->inst->cost64) ? (qi)->delta->data64[k] : (QAPCost) (qi)->delta->data[k])
+
+typedef struct qap_instance
 {
- 				/* --- Problem instance data --- */
+ 				/* --- Problem instance data (read-only once loaded) --- */
   char *file_name;		/* file name */
   int size;			/* size of the problem (always known) */
-  int opt;			/* optimal cost (0 if unknown) */
-  int bound;			/* best bound (0 if unknown) */
-  int bks;			/* best known solution cost (0 if unknown) */
+  QAPCost opt;			/* optimal cost (0 if unknown) */
+  QAPCost bound;		/* best bound (0 if unknown) */
+  QAPCost bks;			/* best known solution cost (0 if unknown) */
 
   QAPMatrix a;			/* flow matrix */
   QAPMatrix b;			/* distance matrix */
-  
+  QAPMatrix ka;			/* a in the kernel width (== a if it is int) */
+  QAPMatrix kb;			/* b in the kernel width (== b if it is int) */
+  QAPMatrix at;			/* transpose of ka (if not symmetric and a is dense or QAP_LOAD_TRANSPOSE, else NULL) */
+  QAPMatrix bt;			/* transpose of kb (if not symmetric and QAP_LOAD_TRANSPOSE, else NULL) */
+  QAPSparseMatrix a_csr;	/* a in CSR form if a is sparse (or NULL) */
+  QAPSparseMatrix at_csr;	/* transpose of a in CSR form (if a_csr and not symmetric, else NULL) */
+  int width;			/* element size of ka, kb, at, bt, pb and pbt (1, 2 or sizeof(int)) */
+  int cost64;			/* 64-bit costs and deltas ? (an int could overflow) */
+  const struct qap_engine *engine; /* delta engine specialized for this width */
+  int symmetric;		/* are both a and b symmetric ? (halved delta computations) */
+  int zero_diag;		/* has a or b a null diagonal ? (no diagonal term in delta) */
+  int permuted_b;		/* do the solving states maintain pb (QAP_LOAD_PERMUTED_B) ? */
+} *QAPInstance;
+
+
+typedef struct
+{
+  QAPCost min;			/* min delta of a row (over all the swaps of an element) */
+  int arg;			/* the other element of a swap giving min (random among ties) */
+  int nb_ties;			/* #swaps giving min (for the random tie-breaking) */
+} QAPRowMin;
+
+
+typedef struct qap_info
+{
+  QAPInstance inst;		/* problem instance (shared by all the solving states of a same problem) */
+
   				/* --- Solving vars --- */
   QAPVector sol;		/* current solution */
-  int cost;			/* current cost */
+  QAPCost cost;			/* current cost */
   int iter_no;			/* current #iteration */
-  QAPMatrix delta;		/* incremental move costs matrix (strictly upper triangular matrix)  */
+  QAPTriMatrix delta;		/* incremental move costs matrix (packed strictly upper triangular, int or long long) */
+  void *swap_vec;		/* work vectors for QAP_Executed_Swap: u, v, u2, v2 of costs (+ 2 int vectors if a_csr) */
+  QAPMatrix pb;			/* permuted distance matrix kb[sol[i]][sol[j]] (or NULL) */
+  QAPMatrix pbt;		/* transpose of pb (if pb and bt are used, else NULL) */
+  QAPRowMin *row_min;		/* min of each row of delta (or NULL, see QAP_Track_Row_Minima) */
+  unsigned (*row_min_random)(unsigned n); /* random generator for the ties of row_min */
 } *QAPInfo;
 
 
 
 
+			/* flags for QAP_Load_Problem */
+#define QAP_LOAD_HEADER_ONLY     1	/* only read the header (no matrix) */
+#define QAP_LOAD_PERMUTED_B      2	/* maintain the permuted distance matrix */
+#define QAP_LOAD_TRANSPOSE       4	/* keep transposed matrices (asymmetric instances only) */
+#define QAP_LOAD_NO_NARROW       8	/* do not use 8/16-bit copies of a and b (kernel width = int) */
+#define QAP_LOAD_COST64         16	/* use 64-bit costs even if int cannot overflow */
+
+#define QAP_SPARSE_DENSITY    0.05	/* default max density of a for the sparse engine */
+
+
+			/* delta update kernels (see QAP_Executed_Swap) */
+enum
+{
+  QAP_KERNEL_SCALAR,
+  QAP_KERNEL_AVX2,
+  QAP_KERNEL_AVX512
+};
+
+
+
 QAPVector QAP_Alloc_Vector(int size);
 
 #define QAP_Free_Vector(v) free(v)
@@ -45,25 +150,55 @@ QAPVector QAP_Alloc_Vector(int size);
 
 QAPMatrix QAP_Alloc_Matrix(int size);
 
-void QAP_Free_Matrix(QAPMatrix mat, int size);
+QAPMatrix QAP_Alloc_Matrix_Width(int size, int elem_size);
+
+void QAP_Free_Matrix(QAPMatrix mat);
+
+QAPTriMatrix QAP_Alloc_Tri_Matrix(int size, int elem_size);
+
+void QAP_Free_Tri_Matrix(QAPTriMatrix mat);
 
 QAPMatrix QAP_Read_Matrix(FILE *f, int size);
 
 void QAP_Display_Vector(QAPVector sol, int size);
 
-void QAP_Display_Matrix(QAPMatrix mat, int size);
+void QAP_Display_Matrix(QAPMatrix mat);
+
+QAPMatrix QAP_Transpose_Matrix(QAPMatrix mat);
+
+int QAP_Is_Symmetric_Matrix(QAPMatrix mat);
+
+int QAP_Has_Zero_Diagonal(QAPMatrix mat);
+
+int QAP_Narrowest_Width(QAPMatrix mat);
+
+QAPMatrix QAP_Narrow_Matrix(QAPMatrix mat, int elem_size);
+
+double QAP_Matrix_Density(QAPMatrix mat);
+
+QAPSparseMatrix QAP_Sparse_Matrix(QAPMatrix mat);
+
+void QAP_Free_Sparse_Matrix(QAPSparseMatrix csr);
+
+void QAP_Set_Sparse_Density(double max_density);
 
 void QAP_Create_Dual_Vector(QAPVector dst, int size, QAPVector src);
 
 void QAP_Switch_To_Dual_Vector(QAPVector sol, int size);
 
 
-QAPInfo QAP_Load_Problem(char *file_name, int header_only);
+QAPInstance QAP_Load_Instance(char *file_name, int flags);
+
+QAPInfo QAP_New_Info(QAPInstance inst);
+
+void QAP_Free_Info(QAPInfo qi);
+
+QAPInfo QAP_Load_Problem(char *file_name, int flags);
 
 void QAP_Set_Solution(QAPInfo qi);
 
 
-int QAP_Cost_Of_Solution(QAPInfo qi);
+QAPCost QAP_Cost_Of_Solution(QAPInfo qi);
 
 void QAP_Compute_Delta(QAPInfo qi, int i, int j);
 
@@ -71,14 +206,30 @@ void QAP_Compute_Delta_Part(QAPInfo qi, int i, int j, int r, int s);
 
 void QAP_Compute_All_Delta(QAPInfo qi);
 
-int QAP_Get_Delta(QAPInfo qi, int i, int j);
+QAPCost QAP_Get_Delta(QAPInfo qi, int i, int j);
 
-int QAP_Cost_If_Swap(QAPInfo qi, int i, int j);
+QAPCost QAP_Cost_If_Swap(QAPInfo qi, int i, int j);
 
-int QAP_Do_Swap(QAPInfo qi, int i, int j);
+QAPCost QAP_Do_Swap(QAPInfo qi, int i, int j);
 
 void QAP_Executed_Swap(QAPInfo qi, int i, int j);
 
+void QAP_Track_Row_Minima(QAPInfo qi, unsigned (*random)(unsigned n));
+
+int QAP_Is_Kernel_Supported(int kernel_no);
+
+int QAP_Select_Kernel(int kernel_no);
+
+char *QAP_Get_Kernel_Name(void);
+
+int QAP_Find_Kernel(char *name);
+
+char *QAP_Get_Width_Name(QAPInfo qi);
+
+void QAP_Set_Delta_Threads(int nb_threads);
+
+int QAP_Get_Delta_Threads(void);
+
 
 
 #endif	/* !_QAP_UTILS_H */
@@ -72,9 +72,9 @@ Init_Main(void)
  *  Display parameters
  */
 void
-Display_Parameters(QAPInfo qi, int target_cost)
+Display_Parameters(QAPInfo qi, QAPCost target_cost)
 {
-  int n = qi->size;		/* problem size */
+  int n = qi->inst->size;		/* problem size */
   if (tabu_duration_factor < 0)
     {
       tabu_duration_factor = -tabu_duration_factor;
@@ -92,14 +92,14 @@ Display_Parameters(QAPInfo qi, int target_cost)
 void
 Solve(QAPInfo qi)
 {
-  int n = qi->size;		/* problem size */
+  int n = qi->inst->size;		/* problem size */
   QAPVector p = qi->sol;
-  int best_cost;		/* cost of best solution */
+  QAPCost best_cost;		/* cost of best solution */
   QAPMatrix tabu_list;		/* tabu status */
-  int current_cost;		/* current sol. value */
+  QAPCost current_cost;		/* current sol. value */
   int i, j;			/* indices */
   int i_retained, j_retained;	/* indices retained move cost */
-  int min_delta;		
+  QAPCost min_delta;		
   int autorized;		/* move not tabu? */
   int aspired;			/* move forced? */
   int already_aspired;		/* in case many moves forced */
@@ -115,7 +115,7 @@ Solve(QAPInfo qi)
   /****************** tabu list initialization *******************/
   for (i = 0; i < n; i++)
     for (j = 0; j < n; j++)
-      tabu_list[i][j] = -(n * i + j);
+      QAP_Elem(tabu_list, i, j) = -(n * i + j);
 
   /******************** main tabu search loop ********************/
   qi->iter_no = 0;
@@ -126,55 +126,62 @@ Solve(QAPInfo qi)
 
       i_retained = infinite;	/* in case all moves are tabu */
       j_retained = infinite;
-      min_delta = infinite;
+      min_delta = QAP_COST_MAX;
 #ifdef USE_RANDOM_ON_BEST
       int best_nb = 0;
 #endif
       already_aspired = FALSE;
 
       for (i = 0; i < n - 1; i++)
-	for (j = i + 1; j < n; j++)
-	  {
-	    int d = QAP_Get_Delta(qi, i, j);
+	{
+	  int *tabu_i = QAP_Row(tabu_list, i);
+	  size_t k = QAP_Delta_Index(qi, i, i + 1);
+
+	  for (j = i + 1; j < n; j++, k++)
+	    {
+	      QAPCost d = QAP_Delta_At(qi, k);
+	      int tabu_ij = tabu_i[p[j]];
+	      int tabu_ji = QAP_Elem(tabu_list, j, p[i]);
 	    
-	    autorized =
-	      (tabu_list[i][p[j]] < qi->iter_no) ||
-	      (tabu_list[j][p[i]] < qi->iter_no);
-
-	    aspired =
-	      (tabu_list[i][p[j]] < qi->iter_no - aspiration) ||
-	      (tabu_list[j][p[i]] < qi->iter_no - aspiration) ||
-	      (current_cost + d < best_cost);
-
-	    if ((aspired && !already_aspired) ||	/* first move aspired */
-		(aspired && already_aspired &&	/* many move aspired */
-		 (d <= min_delta)) ||	/* => take best one */
-		(!aspired && !already_aspired &&	/* no move aspired yet */
-		 (d <= min_delta) && autorized))
-	      {
+	      autorized =
+		(tabu_ij < qi->iter_no) ||
+		(tabu_ji < qi->iter_no);
+
+	      aspired =
+		(tabu_ij < qi->iter_no - aspiration) ||
+		(tabu_ji < qi->iter_no - aspiration) ||
+		(current_cost + d < best_cost);
+
+	      if ((aspired && !already_aspired) ||        /* first move aspired */
+		  (aspired && already_aspired &&  /* many move aspired */
+		   (d <= min_delta)) ||   /* => take best one */
+		  (!aspired && !already_aspired &&        /* no move aspired yet */
+		   (d <= min_delta) && autorized))
+		{
 #ifdef USE_RANDOM_ON_BEST
-		if (d == min_delta)
-		  {
-		    if (Random(++best_nb) > 0)
-		      continue;
-		  }
-		else
-		  best_nb = 1;
+		  if (d == min_delta)
+		    {
+		      if (Random(++best_nb) > 0)
+			continue;
+		    }
+		  else
+		    best_nb = 1;
 #endif
 
-		i_retained = i;
-		j_retained = j;
-		min_delta = d;
+		  i_retained = i;
+		  j_retained = j;
+		  min_delta = d;
 #ifdef FIRST_BEST
-		if (current_cost + min_delta < best_cost)
-		  goto found;
+		  if (current_cost + min_delta < best_cost)
+		    goto found;
 #endif
-		if (aspired)
-		  {
-		    already_aspired = TRUE;
-		  }
-	      }
-	  }
+		  if (aspired)
+		    {
+		      already_aspired = TRUE;
+		    }
+		}
+	    }
+	}
 
       if (i_retained == infinite)
 	printf("All moves are tabu! \n");
@@ -209,13 +216,13 @@ Solve(QAPInfo qi)
 	  //do t2 = (int) (cube(Random_Double()) * tabu_duration); while(t2 <= 2);
 	  t2 = t1;
 #endif
-	  tabu_list[i_retained][p[j_retained]] = qi->iter_no + t1;
-	  tabu_list[j_retained][p[i_retained]] = qi->iter_no + t2;
+	  QAP_Elem(tabu_list, i_retained, p[j_retained]) = qi->iter_no + t1;
+	  QAP_Elem(tabu_list, j_retained, p[i_retained]) = qi->iter_no + t2;
 	}
 
     }
 
   /* free memory */
-  QAP_Free_Matrix(tabu_list, n);
+  QAP_Free_Matrix(tabu_list);
 }
 
@@ -79,7 +79,7 @@ Init_Main(void)
  *  Display parameters
  */
 void
-Display_Parameters(QAPInfo qi, int target_cost)
+Display_Parameters(QAPInfo qi, QAPCost target_cost)
 {
 }
 
@@ -95,13 +95,13 @@ Display_Parameters(QAPInfo qi, int target_cost)
 void
 Solve(QAPInfo qi)
 {
-  int n = qi->size;             /* problem size */
+  int n = qi->inst->size;             /* problem size */
   int i, r, s;
-  int delta;
+  QAPCost delta;
   int k = n*(n-1)/2, mxfail = k, nb_fail;
-  int dmin = INT_MAX, dmax = 0;
+  QAPCost dmin = QAP_COST_MAX, dmax = 0;
   double t0, tf, beta, tfound, temperature;
-  int meilleur_cout = qi->cost;
+  QAPCost meilleur_cout = qi->cost;
 
   for (i = 1; i <= nb_iter_initialisation; i++)
     {
@@ -6,6 +6,10 @@
  *  tools.c: utilities
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE		/* for RUSAGE_THREAD */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -176,15 +180,232 @@ Real_Time(void)
 
 
 
+/*
+ *  THREAD_USER_TIME
+ *
+ *  returns the user time of the calling thread in msecs
+ *  (the user time of the process if not available).
+ */
+long
+Thread_User_Time(void)
+{
+#if defined(__unix__) && defined(RUSAGE_THREAD)
+  struct rusage rsr_usage;
+
+  getrusage(RUSAGE_THREAD, &rsr_usage);
+
+  return (rsr_usage.ru_utime.tv_sec * 1000) + (rsr_usage.ru_utime.tv_usec / 1000);
+#else
+  return User_Time();
+#endif
+}
+
+
+
+
+/*
+ *  COARSE_REAL_TIME
+ *
+ *  returns a monotonic real time in msecs (not related to Real_Time).
+ *  Cheap to call in a loop (no syscall) but with a resolution of a few msecs.
+ */
+long
+Coarse_Real_Time(void)
+{
+#if defined(__linux__) && defined(CLOCK_MONOTONIC_COARSE)
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+
+  return (ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+#else
+  return Real_Time();
+#endif
+}
+
+
+
+
+/*
+ *  Random number generator: xoshiro256** (D. Blackman and S. Vigna)
+ *  https://prng.di.unimi.it/xoshiro256starstar.c
+ *
+ *  The state is given explicitly (RandState) or is the one of the calling
+ *  thread (functions Random_XXX). Rand_Jump advances a state by 2^128 steps
+ *  to get independent streams (e.g. one per thread) from a same seed.
+ */
+
+static __thread RandState thread_rand_state;
+static __thread int thread_rand_seeded = 0;
+
+
+static inline unsigned long long
+Rotl(unsigned long long x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+
+/*
+ *  RAND_NEXT
+ *
+ *  Returns the next 64 random bits of a state.
+ */
+unsigned long long
+Rand_Next(RandState *r)
+{
+  unsigned long long *s = r->s;
+  unsigned long long result = Rotl(s[1] * 5, 7) * 9;
+  unsigned long long t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = Rotl(s[3], 45);
+
+  return result;
+}
+
+
+/*
+ *  RAND_SEED
+ *
+ *  Initializes a state from a seed (the 256 bits are filled with splitmix64).
+ */
+void
+Rand_Seed(RandState *r, unsigned seed)
+{
+  unsigned long long x = seed;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      unsigned long long z = (x += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      r->s[i] = z ^ (z >> 31);
+    }
+}
+
+
+/*
+ *  RAND_JUMP
+ *
+ *  Advances a state by 2^128 steps (equivalent to 2^128 calls to Rand_Next).
+ */
+void
+Rand_Jump(RandState *r)
+{
+  static const unsigned long long jump[] =
+    { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+  unsigned long long s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  int i, b;
+
+  for (i = 0; i < 4; i++)
+    for (b = 0; b < 64; b++)
+      {
+	if (jump[i] & (1ULL << b))
+	  {
+	    s0 ^= r->s[0];
+	    s1 ^= r->s[1];
+	    s2 ^= r->s[2];
+	    s3 ^= r->s[3];
+	  }
+	Rand_Next(r);
+      }
+
+  r->s[0] = s0;
+  r->s[1] = s1;
+  r->s[2] = s2;
+  r->s[3] = s3;
+}
+
+
+/*
+ *  RAND_BOUNDED
+ *
+ *  Returns a random number in [0..n-1] without bias (0 if n == 0).
+ *  D. Lemire's multiply and reject method (no division in general).
+ */
+unsigned
+Rand_Bounded(RandState *r, unsigned n)
+{
+  unsigned long long m = (Rand_Next(r) >> 32) * n;
+  unsigned l = (unsigned) m;
+
+  if (l < n)
+    {
+      unsigned t = -n % n;	/* 2^32 mod n */
+
+      while (l < t)
+	{
+	  m = (Rand_Next(r) >> 32) * n;
+	  l = (unsigned) m;
+	}
+    }
+
+  return m >> 32;
+}
+
+
+/*
+ *  RAND_DOUBLE
+ *
+ *  Returns a random real number in [0..1) (1 not included).
+ */
+double
+Rand_Double(RandState *r)
+{
+  return (Rand_Next(r) >> 11) * 0x1.0p-53;
+}
+
+
+
+/*
+ *  RANDOM_STATE
+ *
+ *  Returns the state of the calling thread (seeded with 1 if not yet done).
+ */
+RandState *
+Random_State(void)
+{
+  if (!thread_rand_seeded)
+    Randomize_Seed(1);
+
+  return &thread_rand_state;
+}
+
+
+
 /*
  *  RANDOMIZE_SEED
  *
  *  Initializes the random number generator with a given seed.
+ *  Each thread has its own generator.
  */
 void
 Randomize_Seed(unsigned seed)
 {
-  srandom(seed);
+  Rand_Seed(&thread_rand_state, seed);
+  thread_rand_seeded = 1;
+}
+
+
+
+/*
+ *  RANDOMIZE_STREAM
+ *
+ *  Initializes the random number generator with stream #stream_no of a seed
+ *  (streams do not overlap).
+ */
+void
+Randomize_Stream(unsigned seed, int stream_no)
+{
+  Randomize_Seed(seed);
+  while (stream_no-- > 0)
+    Rand_Jump(&thread_rand_state);
 }
 
 
@@ -197,7 +418,7 @@ Randomize_Seed(unsigned seed)
 double
 Random_Double(void)
 {
-  return ((double) random()) / (RAND_MAX + 1.0);
+  return Rand_Double(Random_State());
 }
 
 
@@ -212,7 +433,7 @@ Random_Double(void)
 double
 Random_Double1(void)
 {
-  return ((double) random()) / RAND_MAX;
+  return (Rand_Next(Random_State()) >> 11) * (1.0 / ((1ULL << 53) - 1));
 }
 
 
@@ -254,7 +475,7 @@ Randomize(void)
 #else
       seed = GetTickCount();
 #endif
-      count = (count + random()) % 0xFFFFFFF;
+      count = (count + (Rand_Next(Random_State()) >> 33)) % 0xFFFFFFF;
       seed = seed + (getpid() << (seed & 0xFF));
 #ifndef CELL
       seed += getppid();
@@ -280,7 +501,7 @@ Randomize(void)
 unsigned
 Random(unsigned n)
 {
-  return (unsigned) (Random_Double() * n);
+  return Rand_Bounded(Random_State(), n);
 }
 
 
@@ -293,7 +514,7 @@ Random(unsigned n)
 int
 Random_Interval(int inf, int sup)
 {
-  return (int) (Random_Double() * (sup - inf + 1)) + inf;
+  return (int) Rand_Bounded(Random_State(), sup - inf + 1) + inf;
 }
 
 
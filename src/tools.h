@@ -13,9 +13,33 @@ long Real_Time(void);
 
 long User_Time(void);
 
+long Thread_User_Time(void);
+
+long Coarse_Real_Time(void);
+
+
+typedef struct
+{
+  unsigned long long s[4];
+} RandState;			/* state of a random number generator */
+
+unsigned long long Rand_Next(RandState *r);
+
+void Rand_Seed(RandState *r, unsigned seed);
+
+void Rand_Jump(RandState *r);
+
+unsigned Rand_Bounded(RandState *r, unsigned n);
+
+double Rand_Double(RandState *r);
+
+RandState *Random_State(void);
+
 
 void Randomize_Seed(unsigned seed);
 
+void Randomize_Stream(unsigned seed, int stream_no);
+
 unsigned Randomize(void);
 
 double Random_Double(void);